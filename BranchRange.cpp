@@ -1,536 +1,1694 @@
+#include "BranchRange.h"
+#include "BranchRangeLattice.h"
+#include "BranchRangeTransforms.h"
+
 #include "llvm/Pass.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/CFG.h"
 #include "llvm/IR/Function.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
 
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <vector>
+
 using namespace llvm;
 
-namespace
-{
-    struct HppsBranchRange : public FunctionPass
-    {
-        static char ID;
-        HppsBranchRange() : FunctionPass(ID) {}
+#define DEBUG_TYPE "branch-range"
+
+STATISTIC(NumCacheHits, "Functions whose ranges were read from the cache");
+STATISTIC(NumCacheMisses, "Functions analyzed and written to the cache");
+STATISTIC(NumBlockVisits, "Basic blocks visited by the fixpoint");
+STATISTIC(NumReenqueues, "Blocks or instructions scheduled again after a range they read changed");
+STATISTIC(NumRangeUpdates, "Ranges inserted or changed");
+STATISTIC(NumWidenings, "Loop header ranges widened to a threshold or -Inf/+Inf");
+STATISTIC(NumValuesToTop, "Ranges that went to (-Inf, +Inf)");
+
+// Trace of the fixpoint (-debug-only=branch-range), compiled out with NDEBUG like LLVM_DEBUG
+// Level 1: worklist iterations and range updates, level 2: every transfer function
+#ifndef NDEBUG
+#define TRACE(Level, ...)                                                          \
+    do                                                                             \
+    {                                                                              \
+        if (DebugFlag && isCurrentDebugType(DEBUG_TYPE) && TraceLevel >= (Level))  \
+        {                                                                          \
+            __VA_ARGS__;                                                           \
+        }                                                                          \
+    } while (false)
+#else
+#define TRACE(Level, ...) \
+    do                    \
+    {                     \
+    } while (false)
+#endif
+
+namespace
+{
+    // Signed interval in the bit width of the value (see BranchRangeInfo)
+    typedef BranchRangeInfo::Range Range;
+
+    enum RangeStorage
+    {
+        DenseStorage,
+        MapStorage
+    };
+
+    // Storage layout of the value ranges (map kept to benchmark against the dense table)
+    static cl::opt<RangeStorage> StorageLayout(
+        "branch-range-storage", cl::desc("Storage layout of the branch range lattice"),
+        cl::init(DenseStorage),
+        cl::values(clEnumValN(DenseStorage, "dense", "One row of cells per basic block, only the ranges it stores"),
+                   clEnumValN(MapStorage, "map", "Nested std::map per basic block")));
+
+    enum WorkListOrder
+    {
+        RPOOrder,
+        FIFOOrder
+    };
+
+    // Order in which basic blocks are taken from the worklist
+    static cl::opt<WorkListOrder> WorkListMode(
+        "branch-range-worklist", cl::desc("Visit order of the branch range worklist"),
+        cl::init(RPOOrder),
+        cl::values(clEnumValN(RPOOrder, "rpo", "Lowest reverse post-order number first"),
+                   clEnumValN(FIFOOrder, "fifo", "First in, first out")));
+
+    enum FixpointMode
+    {
+        SparseEngine,
+        DenseEngine
+    };
+
+    // Unit of work of the fixpoint (single instructions or whole basic blocks)
+    static cl::opt<FixpointMode> EngineMode(
+        "branch-range-engine", cl::desc("Propagation engine of the branch range fixpoint"),
+        cl::init(SparseEngine),
+        cl::values(clEnumValN(SparseEngine, "sparse", "Re-evaluate only the users of changed ranges"),
+                   clEnumValN(DenseEngine, "dense", "Re-evaluate every instruction of changed basic blocks")));
+
+    static cl::opt<bool> PrintCounters(
+        "branch-range-counters", cl::desc("Print the fixpoint counters after the value ranges"),
+        cl::init(false));
+
+    // Detail of the trace (see TRACE)
+    static cl::opt<unsigned> TraceLevel(
+        "branch-range-trace-level", cl::desc("Detail of the -debug-only=branch-range trace (1: updates, 2: every instruction)"),
+        cl::init(2));
+
+    // Narrowing steps of each loop header range after the ascending phase (see FixpointState)
+    static cl::opt<unsigned> NarrowingLimit(
+        "branch-range-narrowing", cl::desc("Maximum number of narrowing steps for each loop header range"),
+        cl::init(3));
+
+    // Edges of a br-complex with an empty range for the compared value are not taken (see evaluateInstruction)
+    static cl::opt<bool> PruneEdges(
+        "branch-range-prune-edges", cl::desc("Do not take the branch edges on which the compared value has an empty range"),
+        cl::init(true));
+
+    // Threads of the module driver (-branch-range-module, print<branch-range-module>)
+    static cl::opt<unsigned> ThreadCount(
+        "branch-range-threads", cl::desc("Threads analyzing the functions of a module (0: one for each hardware thread)"),
+        cl::init(0));
+
+    // Persistent cache of the ranges of each function (see RangeCache), disabled when empty
+    static cl::opt<std::string> CacheDir(
+        "branch-range-cache-dir", cl::desc("Directory of the cache of the branch ranges of each function"),
+        cl::init(""));
+
+    // Values queried by print<branch-range-query>, every compared value and index when empty
+    static cl::list<std::string> QueryValues(
+        "branch-range-query-values", cl::desc("Names of the values queried by print<branch-range-query>"),
+        cl::CommaSeparated);
+
+    // Trace of the worklist iterations (see WorklistTrace), disabled when empty
+    static cl::opt<std::string> TimeTraceFile(
+        "branch-range-time-trace", cl::desc("Write a span for each function and worklist iteration to the file (-ftime-trace JSON)"),
+        cl::init(""));
+
+    // Phases of a run timed with -time-passes or -stats (tripcounts are computed inside the phi joins)
+    enum RangePhase
+    {
+        TransferPhase,
+        PhiPhase,
+        BranchPhase,
+        TripcountPhase,
+        PrintPhase,
+        NumPhases
+    };
+
+    typedef std::chrono::steady_clock TraceClock;
+
+    // Time of the phases, summed over the run and printed once when LLVM shuts down
+    // A phase is timed around every instruction: steady_clock reads only, a Timer (getrusage at
+    // each start and stop) would cost more than most transfer functions
+    struct PhaseTimes
+    {
+        ~PhaseTimes()
+        {
+            std::chrono::duration<double> total(totals[TransferPhase] + totals[PhiPhase] + totals[BranchPhase] + totals[PrintPhase]);
+            if (total.count() == 0)
+            {
+                return;
+            }
+
+            static const char *const names[NumPhases] = {"Transfer functions (cmp, binary operators)", "Phi joins",
+                                                         "Branch refinement", "Loop tripcounts (maxTripcount, inside the phi joins)",
+                                                         "Report printing"};
+            raw_ostream &OS = errs();
+            OS << "===" << std::string(73, '-') << "===\n";
+            OS << "                      Branch range analysis phases\n";
+            OS << "===" << std::string(73, '-') << "===\n";
+            OS << format("  Total Execution Time: %.4f seconds (wall clock)\n\n", total.count());
+            OS << "   ---Wall Time---   ---Regions---  --- Name ---\n";
+            for (unsigned phase = 0; phase < NumPhases; ++phase)
+            {
+                std::chrono::duration<double> seconds(totals[phase]);
+                OS << format("  %7.4f (%5.1f%%)  %14llu  %s\n", seconds.count(), 100 * seconds.count() / total.count(),
+                             (unsigned long long)regions[phase], names[phase]);
+            }
+            OS << format("  %7.4f (100.0%%)                  Total\n\n", total.count());
+        }
+
+        void add(RangePhase phase, TraceClock::duration elapsed)
+        {
+            totals[phase] += elapsed;
+            ++regions[phase];
+        }
+
+        TraceClock::duration totals[NumPhases] = {};
+        uint64_t regions[NumPhases] = {};
+    };
+
+    static ManagedStatic<PhaseTimes> phaseTimes;
+
+    bool isTimingEnabled()
+    {
+        return TimePassesIsEnabled || AreStatisticsEnabled();
+    }
+
+    // Adds the time of its scope to the phase, nothing when not timed
+    class PhaseRegion
+    {
+    public:
+        PhaseRegion(RangePhase phase, bool isTimed) : phase(phase), isTimed(isTimed)
+        {
+            if (isTimed)
+            {
+                start = TraceClock::now();
+            }
+        }
+
+        ~PhaseRegion()
+        {
+            if (isTimed)
+            {
+                phaseTimes->add(phase, TraceClock::now() - start);
+            }
+        }
+
+    private:
+        RangePhase phase;
+        bool isTimed;
+        TraceClock::time_point start;
+    };
+
+    // Span of the worklist trace: a whole function (count: worklist iterations) or one worklist
+    // iteration (count: its number), detail: name of the function or of the block
+    struct TraceSpan
+    {
+        const char *name;
+        std::string detail;
+        TraceClock::time_point start;
+        TraceClock::time_point end;
+        bool isFunction;
+        unsigned count;
+        unsigned updates;
+    };
+
+    // Worklist iterations of every analyzed function (-branch-range-time-trace), written when LLVM shuts down
+    // Chrome trace format of -ftime-trace: complete events ("ph": "X") in microseconds since the first
+    // function, the function or block name in args.detail, the ranges updated in args.updates
+    class WorklistTrace
+    {
+    public:
+        ~WorklistTrace()
+        {
+            if (!spans.empty())
+            {
+                write();
+            }
+        }
+
+        // Span of a function and of its iterations, analyzed on the calling thread
+        void addFunction(TraceSpan funcSpan, std::vector<TraceSpan> iterationSpans)
+        {
+            uint64_t tid = get_threadid();
+            std::lock_guard<std::mutex> lock(spansMutex);
+            spans.emplace_back(tid, std::move(funcSpan));
+            for (TraceSpan &span : iterationSpans)
+            {
+                spans.emplace_back(tid, std::move(span));
+            }
+        }
+
+    private:
+        void write()
+        {
+            std::error_code EC;
+            raw_fd_ostream OS(TimeTraceFile, EC, sys::fs::OF_Text);
+            if (EC)
+            {
+                errs() << "branch-range: cannot write " << TimeTraceFile << ": " << EC.message() << "\n";
+                return;
+            }
+
+            // Start of the first function, on both clocks
+            TraceClock::time_point beginning = spans.front().second.start;
+            for (const std::pair<uint64_t, TraceSpan> &threadSpan : spans)
+            {
+                beginning = std::min(beginning, threadSpan.second.start);
+            }
+            std::chrono::system_clock::time_point beginningOfTime =
+                std::chrono::system_clock::now() - std::chrono::duration_cast<std::chrono::system_clock::duration>(TraceClock::now() - beginning);
+
+            json::OStream J(OS);
+            J.objectBegin();
+            J.attributeArray("traceEvents", [&] {
+                for (const std::pair<uint64_t, TraceSpan> &threadSpan : spans)
+                {
+                    const TraceSpan &span = threadSpan.second;
+                    J.object([&] {
+                        J.attribute("pid", 1);
+                        J.attribute("tid", int64_t(threadSpan.first));
+                        J.attribute("ph", "X");
+                        J.attribute("ts", getMicroseconds(span.start - beginning));
+                        J.attribute("dur", getMicroseconds(span.end - span.start));
+                        J.attribute("name", span.name);
+                        J.attributeObject("args", [&] {
+                            J.attribute("detail", span.detail);
+                            J.attribute(span.isFunction ? "iterations" : "iteration", span.count);
+                            J.attribute("updates", span.updates);
+                        });
+                    });
+                }
+                J.object([&] {
+                    J.attribute("pid", 1);
+                    J.attribute("tid", 0);
+                    J.attribute("ph", "M");
+                    J.attribute("name", "process_name");
+                    J.attributeObject("args", [&] { J.attribute("name", "branch-range"); });
+                });
+            });
+            J.attribute("beginningOfTime", int64_t(std::chrono::duration_cast<std::chrono::microseconds>(beginningOfTime.time_since_epoch()).count()));
+            J.objectEnd();
+        }
+
+        // Fractional: a sparse iteration takes less than a microsecond
+        static double getMicroseconds(TraceClock::duration duration)
+        {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        }
+
+        std::mutex spansMutex;
+        std::vector<std::pair<uint64_t, TraceSpan>> spans;
+    };
+
+    static ManagedStatic<WorklistTrace> worklistTrace;
+
+    // Worklist iteration recorded in spans at the end of the scope (nothing when spans is nullptr)
+    // Ranges updated: updates of counters while in scope
+    class IterationScope
+    {
+    public:
+        IterationScope(std::vector<TraceSpan> *spans, const char *name, BasicBlock *BB, unsigned iteration, const FixpointCounters &counters)
+            : spans(spans), name(name), BB(BB), iteration(iteration), counters(counters), updatesBefore(counters.updates)
+        {
+            if (spans != nullptr)
+            {
+                start = TraceClock::now();
+            }
+        }
+
+        ~IterationScope()
+        {
+            if (spans == nullptr)
+            {
+                return;
+            }
+
+            // Unnamed blocks by their number (%3)
+            std::string label = BB->getName().str();
+            if (label.empty())
+            {
+                raw_string_ostream labelOS(label);
+                BB->printAsOperand(labelOS, /* PrintType */ false);
+                labelOS.flush();
+            }
+            spans->push_back(TraceSpan{name, label, start, TraceClock::now(), false, iteration, counters.updates - updatesBefore});
+        }
+
+    private:
+        std::vector<TraceSpan> *spans;
+        const char *name;
+        BasicBlock *BB;
+        unsigned iteration;
+        const FixpointCounters &counters;
+        unsigned updatesBefore;
+        TraceClock::time_point start;
+    };
+
+    // Worklist of basic blocks or instructions left to cycle
+    // Nodes are numbered in reverse post-order, membership is a bit for each node
+    // RPO: min-heap on the node number (pop in O(log n))
+    // FIFO: queue in insertion order (pop in O(1))
+    template <typename NodeT>
+    class RPOWorkList
+    {
+    public:
+        RPOWorkList(const std::vector<NodeT *> &rpoNodes, WorkListOrder order) : order(order), rpoBlocks(rpoNodes)
+        {
+            for (unsigned number = 0; number < rpoBlocks.size(); ++number)
+            {
+                rpoNumber[rpoBlocks[number]] = number;
+            }
+
+            inList.resize(rpoBlocks.size());
+        }
+
+        bool empty() const
+        {
+            return order == RPOOrder ? heap.empty() : fifo.empty();
+        }
+
+        bool contains(NodeT *BB) const
+        {
+            typename DenseMap<NodeT *, unsigned>::const_iterator numberIt = rpoNumber.find(BB);
+            return numberIt != rpoNumber.end() && inList.test(numberIt->second);
+        }
+
+        // Insert the node, unless already inside the worklist (false)
+        bool push(NodeT *BB)
+        {
+            unsigned number = rpoNumber.find(BB)->second;
+            if (inList.test(number))
+            {
+                return false;
+            }
+
+            inList.set(number);
+            if (order == RPOOrder)
+            {
+                heap.push(number);
+            }
+            else
+            {
+                fifo.push_back(number);
+            }
+            return true;
+        }
+
+        // Get next node and remove it
+        NodeT *pop()
+        {
+            unsigned number;
+            if (order == RPOOrder)
+            {
+                number = heap.top();
+                heap.pop();
+            }
+            else
+            {
+                number = fifo.front();
+                fifo.pop_front();
+            }
+
+            inList.reset(number);
+            return rpoBlocks[number];
+        }
+
+    private:
+        WorkListOrder order;
+        DenseMap<NodeT *, unsigned> rpoNumber;
+        std::vector<NodeT *> rpoBlocks;
+        BitVector inList;
+        std::priority_queue<unsigned, std::vector<unsigned>, std::greater<unsigned>> heap;
+        std::deque<unsigned> fifo;
+    };
+
+    typedef RPOWorkList<BasicBlock> BlockWorkList;
+
+    // Scheduling of the fixpoint
+    // Ranges are cells (BB, value), every transfer function records the cells it reads
+    // Dense: when a cell changes the basic blocks of its readers are re-visited (all instructions)
+    // Sparse: when a cell changes only its readers are re-evaluated
+    class FixpointEngine
+    {
+    public:
+        FixpointEngine(Function &Func, FixpointMode mode, WorkListOrder order)
+            : mode(mode), blocks(getRPOBlocks(Func), order), instructions(getRPOInstructions(Func), order)
+        {
+        }
+
+        bool isSparse() const
+        {
+            return mode == SparseEngine;
+        }
+
+        bool empty() const
+        {
+            return isSparse() ? instructions.empty() : blocks.empty();
+        }
+
+        bool containsBlock(BasicBlock *BB) const
+        {
+            return blocks.contains(BB);
+        }
+
+        // Dense: schedule the basic block, Sparse: schedule its instructions (first visit)
+        void pushBlock(BasicBlock *BB)
+        {
+            if (!isSparse())
+            {
+                blocks.push(BB);
+                return;
+            }
+
+            ++counters.blockVisits;
+            for (Instruction &I : *BB)
+            {
+                if (hasTransferFunction(&I))
+                {
+                    instructions.push(&I);
+                }
+            }
+        }
+
+        // Dense: schedule the basic block of I, Sparse: schedule I only
+        void pushInstruction(Instruction *I)
+        {
+            if (!isSparse())
+            {
+                blocks.push(I->getParent());
+                return;
+            }
+
+            instructions.push(I);
+        }
+
+        BasicBlock *popBlock()
+        {
+            ++counters.blockVisits;
+            return blocks.pop();
+        }
+
+        Instruction *popInstruction()
+        {
+            return instructions.pop();
+        }
+
+        // Instruction whose transfer function is being evaluated (reader of the next cells)
+        void beginEvaluation(Instruction *I)
+        {
+            current = I;
+            if (hasTransferFunction(I))
+            {
+                ++counters.evaluations;
+            }
+        }
+
+        // Record that the current instruction reads the range of operand in BB
+        void read(BasicBlock *BB, Value *operand)
+        {
+            if (current == nullptr)
+            {
+                return;
+            }
+
+            SmallVector<Instruction *, 2> &cellReaders = readers[std::make_pair(BB, operand)];
+            if (!is_contained(cellReaders, current))
+            {
+                cellReaders.push_back(current);
+            }
+        }
+
+        // Range of operand in BB changed, re-evaluate its readers
+        void update(BasicBlock *BB, Value *operand)
+        {
+            ++counters.updates;
+            DenseMap<std::pair<BasicBlock *, Value *>, SmallVector<Instruction *, 2>>::iterator readIt = readers.find(std::make_pair(BB, operand));
+            if (readIt == readers.end())
+            {
+                return;
+            }
+
+            for (Instruction *reader : readIt->second)
+            {
+                if (!isSparse())
+                {
+                    counters.reenqueues += blocks.push(reader->getParent());
+                }
+                else if (reader != current)
+                {
+                    counters.reenqueues += instructions.push(reader);
+                }
+            }
+        }
+
+        FixpointCounters counters;
+
+    private:
+        // Instructions that read or write ranges (see evaluateInstruction)
+        static bool hasTransferFunction(Instruction *I)
+        {
+            return isa<CmpInst>(I) || isa<BinaryOperator>(I) || isa<PHINode>(I) || I->isTerminator();
+        }
+
+        static std::vector<BasicBlock *> getRPOBlocks(Function &Func)
+        {
+            ReversePostOrderTraversal<Function *> RPOT(&Func);
+            return std::vector<BasicBlock *>(RPOT.begin(), RPOT.end());
+        }
+
+        static std::vector<Instruction *> getRPOInstructions(Function &Func)
+        {
+            std::vector<Instruction *> rpoInstructions;
+            for (BasicBlock *BB : getRPOBlocks(Func))
+            {
+                for (Instruction &I : *BB)
+                {
+                    if (hasTransferFunction(&I))
+                    {
+                        rpoInstructions.push_back(&I);
+                    }
+                }
+            }
+
+            return rpoInstructions;
+        }
+
+        FixpointMode mode;
+        BlockWorkList blocks;
+        RPOWorkList<Instruction> instructions;
+        Instruction *current = nullptr;
+
+        // Instructions that read each cell (BB, value)
+        DenseMap<std::pair<BasicBlock *, Value *>, SmallVector<Instruction *, 2>> readers;
+    };
+
+    // Lattice state of a run shared by the transfer functions
+    // Ascending phase: a range only grows (join with the previous range); in loop headers
+    // (targets of back-edges) a growing bound jumps to the next cmp threshold, then to -Inf/+Inf
+    // Narrowing phase: a range only shrinks (meet with the previous range), at most
+    // NarrowingLimit times for a range inside a loop header
+    //
+    // Thresholds are kept for each bit width (ranges of a value never mix widths)
+    //
+    // Convergence: with T thresholds, a loop header range changes at most 2 * (T + 2) times
+    // while ascending and NarrowingLimit times while narrowing. Every cycle of the CFG crosses
+    // a loop header, the other ranges only change when one of the ranges they read changes.
+    // Ranges flow along executable edges only: an edge is taken once its source is reached
+    struct FixpointState
+    {
+        DominatorTree *domTree = nullptr;
+        bool isNarrowing = false;
+        DenseMap<unsigned, std::vector<APInt>> thresholds;
+        SmallPtrSet<const BasicBlock *, 8> loopHeaders;
+        DenseSet<std::pair<BasicBlock *, BasicBlock *>> executableEdges;
+        DenseMap<std::pair<BasicBlock *, Value *>, unsigned> narrowings;
+        // Smallest tripcount of the loop condition block, when the compared value is the phi of the loop (see maxTripcount)
+        DenseMap<BasicBlock *, uint64_t> tripcounts;
+    };
+
+    // Dense lattice storage
+    // One row of cells for each visited basic block, holding only the ranges the block stores
+    // (a block refines few of the values of the function)
+    // {
+    //      row(BB1): [ %k: minRange, maxRange ], [ %n: minRange, maxRange ]
+    // }
+    // Cells of a row are contiguous and sorted by value like the keys of MapRangeTable: found by
+    // binary search, listed in the order of the map report without sorting
+    // Bounds up to 64 bits are stored sign-extended in the cell, wider bounds in wideRanges
+    class DenseRangeTable
+    {
+    public:
+        DenseRangeTable(Function &Func)
+        {
+            blockRow.reserve(Func.size());
+        }
+
+        bool isVisited(BasicBlock *BB) const
+        {
+            return blockRow.find(BB) != blockRow.end();
+        }
+
+        // Allocate an empty row for the basic block
+        void markVisited(BasicBlock *BB)
+        {
+            if (blockRow.insert(std::make_pair(BB, unsigned(rows.size()))).second)
+            {
+                rows.emplace_back();
+            }
+        }
+
+        bool hasRange(BasicBlock *BB, Value *operand) const
+        {
+            const Row *row = getRow(BB);
+            if (!row)
+            {
+                return false;
+            }
+
+            Row::const_iterator cellIt = findCell(*row, operand);
+            return cellIt != row->end() && cellIt->value == operand;
+        }
+
+        // Range of a value already in the table (see hasRange)
+        Range getRange(BasicBlock *BB, Value *operand) const
+        {
+            const Row *row = getRow(BB);
+            return getCellRange(BB, *findCell(*row, operand));
+        }
+
+        // Insert or update the range of a value inside a visited basic block
+        void setRange(BasicBlock *BB, Value *operand, const Range &range)
+        {
+            DenseMap<BasicBlock *, unsigned>::const_iterator rowIt = blockRow.find(BB);
+            assert(rowIt != blockRow.end() && "Range stored in a block not visited");
+            Row &row = rows[rowIt->second];
+
+            Row::iterator cellIt = findCell(row, operand);
+            if (cellIt == row.end() || cellIt->value != operand)
+            {
+                cellIt = row.insert(cellIt, Cell{operand, 0, 0});
+            }
+
+            if (range.first.getBitWidth() <= 64)
+            {
+                cellIt->minRange = range.first.getSExtValue();
+                cellIt->maxRange = range.second.getSExtValue();
+            }
+            else
+            {
+                wideRanges[std::make_pair(BB, operand)] = range;
+            }
+        }
+
+        // Call Fn(value, range) for every range stored in a visited basic block (order of MapRangeTable)
+        template <typename CallbackT>
+        void forEachRange(BasicBlock *BB, CallbackT Fn) const
+        {
+            const Row *row = getRow(BB);
+            if (!row)
+            {
+                return;
+            }
+
+            for (const Cell &cell : *row)
+            {
+                Fn(cell.value, getCellRange(BB, cell));
+            }
+        }
+
+    private:
+        struct Cell
+        {
+            Value *value;
+            int64_t minRange;
+            int64_t maxRange;
+        };
+        typedef std::vector<Cell> Row;
+
+        const Row *getRow(BasicBlock *BB) const
+        {
+            DenseMap<BasicBlock *, unsigned>::const_iterator rowIt = blockRow.find(BB);
+            return rowIt == blockRow.end() ? nullptr : &rows[rowIt->second];
+        }
+
+        // First cell of the row not ordered before the value
+        template <typename RowT>
+        static auto findCell(RowT &row, Value *operand) -> decltype(row.begin())
+        {
+            return std::lower_bound(row.begin(), row.end(), operand, [](const Cell &cell, Value *value) { return std::less<Value *>()(cell.value, value); });
+        }
+
+        Range getCellRange(BasicBlock *BB, const Cell &cell) const
+        {
+            unsigned width = cell.value->getType()->getIntegerBitWidth();
+            if (width > 64)
+            {
+                return wideRanges.find(std::make_pair(BB, cell.value))->second;
+            }
+            return Range(APInt(width, cell.minRange, /* isSigned */ true), APInt(width, cell.maxRange, /* isSigned */ true));
+        }
+
+        DenseMap<BasicBlock *, unsigned> blockRow;
+        std::vector<Row> rows;
+        DenseMap<std::pair<BasicBlock *, Value *>, Range> wideRanges;
+    };
+
+    // Original layout, one std::map of ranges for each visited basic block
+    // {
+    //      "BB1": { '%k', { 0, 100 } }
+    // }
+    class MapRangeTable
+    {
+    public:
+        MapRangeTable(Function &) {}
+
+        bool isVisited(BasicBlock *BB) const
+        {
+            return listRange.find(BB) != listRange.end();
+        }
+
+        void markVisited(BasicBlock *BB)
+        {
+            listRange.insert(std::pair<BasicBlock *, std::map<Value *, Range>>(BB, std::map<Value *, Range>()));
+        }
+
+        bool hasRange(BasicBlock *BB, Value *operand) const
+        {
+            std::map<BasicBlock *, std::map<Value *, Range>>::const_iterator blockIt = listRange.find(BB);
+            return blockIt != listRange.end() && blockIt->second.find(operand) != blockIt->second.end();
+        }
+
+        Range getRange(BasicBlock *BB, Value *operand) const
+        {
+            return listRange.find(BB)->second.find(operand)->second;
+        }
+
+        void setRange(BasicBlock *BB, Value *operand, const Range &range)
+        {
+            listRange.find(BB)->second[operand] = range;
+        }
+
+        template <typename CallbackT>
+        void forEachRange(BasicBlock *BB, CallbackT Fn) const
+        {
+            std::map<BasicBlock *, std::map<Value *, Range>>::const_iterator blockIt = listRange.find(BB);
+            if (blockIt == listRange.end())
+            {
+                return;
+            }
+
+            std::map<Value *, Range>::const_iterator resIt;
+            for (resIt = blockIt->second.begin(); resIt != blockIt->second.end(); ++resIt)
+            {
+                Fn(resIt->first, resIt->second);
+            }
+        }
+
+    private:
+        std::map<BasicBlock *, std::map<Value *, Range>> listRange;
+    };
+
+    std::string printRange(const Range &rangeVal)
+    {
+        return IntervalLattice::toString(rangeVal);
+    }
+
+    // On-disk cache of the result of the fixpoint, one file for each function in CacheDir
+    // Key: MD5 of the structure of the function (instructions, operands, constants, CFG), the
+    // options changing the ranges and the format version. Blocks and values are stored by their
+    // number in the function (arguments, then instructions), constant cmp operands by their cmp and
+    // operand number (nothing is created in the LLVMContext), names are read from the IR
+    // A hit has no fixpoint counters (only "Cache: hit" with -branch-range-counters)
+    // Files are written to a unique temporary file and renamed: concurrent runs (and the threads
+    // of the module driver) never read a partial file
+    // Bumped when the transfer functions or the file format change
+    const char CacheFormat[] = "branch-range-cache 5";
+
+    class RangeCache
+    {
+    public:
+        explicit RangeCache(Function &Func)
+        {
+            for (Argument &arg : Func.args())
+            {
+                valueIndex[&arg] = values.size();
+                values.push_back(&arg);
+            }
+            for (BasicBlock &BB : Func)
+            {
+                blockIndex[&BB] = blocks.size();
+                blocks.push_back(&BB);
+                for (Instruction &I : BB)
+                {
+                    valueIndex[&I] = values.size();
+                    values.push_back(&I);
+                    if (!isa<CmpInst>(I))
+                    {
+                        continue;
+                    }
+                    for (unsigned opIdx = 0; opIdx < I.getNumOperands(); ++opIdx)
+                    {
+                        if (isa<ConstantInt>(I.getOperand(opIdx)))
+                        {
+                            constantOperand.insert(std::make_pair(I.getOperand(opIdx), std::make_pair(valueIndex[&I], opIdx)));
+                        }
+                    }
+                }
+            }
+            path = CacheDir;
+            sys::path::append(path, hashFunction(Func) + ".ranges");
+        }
+
+        // Ranges read from the cache file into info, false when missing or unreadable
+        bool load(BranchRangeInfo *info) const
+        {
+            ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(path);
+            if (!buffer)
+            {
+                return false;
+            }
+
+            BranchRangeInfo loaded;
+            line_iterator lineIt(**buffer);
+            if (lineIt.is_at_eof() || *lineIt != CacheFormat)
+            {
+                return false;
+            }
+            for (++lineIt; !lineIt.is_at_eof(); ++lineIt)
+            {
+                SmallVector<StringRef, 4> fields;
+                lineIt->split(fields, ' ');
+                unsigned index;
+                if (fields[0] == "B" && fields.size() == 2)
+                {
+                    if (fields[1].getAsInteger(10, index) || index >= blocks.size())
+                    {
+                        return false;
+                    }
+                    loaded.addBlock(blocks[index]);
+                }
+                else if (fields[0] == "E" && fields.size() == 3)
+                {
+                    unsigned toIndex;
+                    if (fields[1].getAsInteger(10, index) || index >= blocks.size() || fields[2].getAsInteger(10, toIndex) || toIndex >= blocks.size())
+                    {
+                        return false;
+                    }
+                    loaded.addEdge(blocks[index], blocks[toIndex]);
+                }
+                else if (fields[0] == "T" && fields.size() == 3)
+                {
+                    uint64_t tripcount;
+                    if (fields[1].getAsInteger(10, index) || index >= blocks.size() || fields[2].getAsInteger(10, tripcount))
+                    {
+                        return false;
+                    }
+                    loaded.addTripcount(blocks[index], tripcount);
+                }
+                else if (fields[0] == "R" && fields.size() == 4 && !loaded.getVisitedBlocks().empty())
+                {
+                    // Bounds in decimal (signed), in the bit width of the value
+                    if (fields[1].getAsInteger(10, index) || index >= values.size() || !values[index]->getType()->isIntegerTy())
+                    {
+                        return false;
+                    }
+                    Range range;
+                    unsigned width = values[index]->getType()->getIntegerBitWidth();
+                    if (!parseBound(fields[2], width, &range.first) || !parseBound(fields[3], width, &range.second))
+                    {
+                        return false;
+                    }
+                    loaded.addRange(loaded.getVisitedBlocks().back(), values[index], range);
+                }
+                else if (fields[0] == "K" && fields.size() == 5 && !loaded.getVisitedBlocks().empty())
+                {
+                    // Constant operand opIdx of the cmp instruction index
+                    unsigned opIdx;
+                    if (fields[1].getAsInteger(10, index) || index >= values.size() || !isa<CmpInst>(values[index]) ||
+                        fields[2].getAsInteger(10, opIdx) || opIdx >= cast<CmpInst>(values[index])->getNumOperands())
+                    {
+                        return false;
+                    }
+                    Value *constant = cast<CmpInst>(values[index])->getOperand(opIdx);
+                    Range range;
+                    if (!isa<ConstantInt>(constant) || !parseBound(fields[3], constant->getType()->getIntegerBitWidth(), &range.first) ||
+                        !parseBound(fields[4], constant->getType()->getIntegerBitWidth(), &range.second))
+                    {
+                        return false;
+                    }
+                    loaded.addRange(loaded.getVisitedBlocks().back(), constant, range);
+                }
+                else
+                {
+                    return false;
+                }
+            }
+
+            *info = std::move(loaded);
+            return true;
+        }
+
+        // Ranges of info written to the cache file (a range of another value is left out)
+        void store(const BranchRangeInfo &info) const
+        {
+            std::string content = std::string(CacheFormat) + "\n";
+            raw_string_ostream OS(content);
+            for (BasicBlock *BB : info.getVisitedBlocks())
+            {
+                OS << "B " << blockIndex.lookup(BB) << "\n";
+                for (const std::pair<Value *, BranchRangeInfo::Range> &valueRange : info.getBlockRanges(BB))
+                {
+                    std::string bounds = toString(valueRange.second.first, 10, /* Signed */ true) + " " + toString(valueRange.second.second, 10, /* Signed */ true);
+                    DenseMap<const Value *, unsigned>::const_iterator valueIt = valueIndex.find(valueRange.first);
+                    if (valueIt != valueIndex.end())
+                    {
+                        OS << "R " << valueIt->second << " " << bounds << "\n";
+                        continue;
+                    }
+                    DenseMap<const Value *, std::pair<unsigned, unsigned>>::const_iterator constantIt = constantOperand.find(valueRange.first);
+                    if (constantIt != constantOperand.end())
+                    {
+                        OS << "K " << constantIt->second.first << " " << constantIt->second.second << " " << bounds << "\n";
+                    }
+                }
+                for (BasicBlock *succ : successors(BB))
+                {
+                    if (info.isExecutableEdge(BB, succ))
+                    {
+                        OS << "E " << blockIndex.lookup(BB) << " " << blockIndex.lookup(succ) << "\n";
+                    }
+                }
+                if (uint64_t tripcount = info.getMaxTripcount(BB))
+                {
+                    OS << "T " << blockIndex.lookup(BB) << " " << tripcount << "\n";
+                }
+            }
+            OS.flush();
+
+            if (sys::fs::create_directories(CacheDir))
+            {
+                return;
+            }
+            int tempFD;
+            SmallString<128> tempPath;
+            if (sys::fs::createUniqueFile(path + ".%%%%%%%%.tmp", tempFD, tempPath))
+            {
+                return;
+            }
+            {
+                raw_fd_ostream tempOS(tempFD, /* shouldClose */ true);
+                tempOS << content;
+                if (tempOS.has_error())
+                {
+                    tempOS.clear_error();
+                    sys::fs::remove(tempPath);
+                    return;
+                }
+            }
+            if (sys::fs::rename(tempPath, path))
+            {
+                sys::fs::remove(tempPath);
+            }
+        }
+
+    private:
+        // Signed decimal bound in the given bit width, false when invalid or out of the width
+        static bool parseBound(StringRef text, unsigned width, APInt *bound)
+        {
+            bool isNegative = text.consume_front("-");
+            APInt magnitude;
+            if (text.getAsInteger(10, magnitude))
+            {
+                return false;
+            }
+
+            magnitude = magnitude.zext(std::max(magnitude.getBitWidth(), width) + 1);
+            if (isNegative)
+            {
+                magnitude.negate();
+            }
+            if (magnitude.getMinSignedBits() > width)
+            {
+                return false;
+            }
+            *bound = magnitude.trunc(width);
+            return true;
+        }
+
+        // Structural hash of the function, the names only count through hasName (see evaluateInstruction)
+        std::string hashFunction(Function &Func) const
+        {
+            MD5 hash;
+            hash.update(CacheFormat);
+            hashInt(&hash, NarrowingLimit.getValue());
+            hashInt(&hash, PruneEdges.getValue());
+            hashInt(&hash, Func.arg_size());
+            for (Argument &arg : Func.args())
+            {
+                hashType(&hash, arg.getType());
+                hashInt(&hash, arg.hasName());
+            }
+            for (BasicBlock &BB : Func)
+            {
+                hashInt(&hash, BB.size());
+                for (Instruction &I : BB)
+                {
+                    hashInt(&hash, I.getOpcode());
+                    hashInt(&hash, I.getRawSubclassOptionalData());
+                    hashInt(&hash, I.hasName());
+                    hashType(&hash, I.getType());
+                    if (auto *cmpInst = dyn_cast<CmpInst>(&I))
+                    {
+                        hashInt(&hash, cmpInst->getPredicate());
+                    }
+                    if (auto *phiInst = dyn_cast<PHINode>(&I))
+                    {
+                        // Incoming blocks are not operands of the phi
+                        for (BasicBlock *incBB : phiInst->blocks())
+                        {
+                            hashInt(&hash, blockIndex.lookup(incBB));
+                        }
+                    }
+                    hashInt(&hash, I.getNumOperands());
+                    for (Value *operand : I.operands())
+                    {
+                        hashOperand(&hash, operand);
+                    }
+                }
+            }
+
+            MD5::MD5Result result;
+            hash.final(result);
+            return result.digest().str().str();
+        }
 
-        // Run over a single function
-        bool runOnFunction(Function &Func) override
+        static void hashInt(MD5 *hash, uint64_t value)
         {
-            // --- PLACEHOLDERS/DEFAULTS --- //
-            // Create a Null Value reference
-            // Assigned as placeholder when no variable reference available
-            LLVMContext &context = Func.getContext();
-            Value *nullValue = ConstantInt::get(Type::getInt32Ty(context), -1);
-
-            // Max int range (infinity)
-            int infMax = std::numeric_limits<int>::max();
-            int infMin = std::numeric_limits<int>::min();
-            int maxLoops = 1000;
-            int iterLoops = 0;
+            uint8_t bytes[8];
+            support::endian::write64le(bytes, value);
+            hash->update(bytes);
+        }
 
-            // Create Null range reference
-            std::pair<int, int> emptyIntPair(infMin, infMax);
-            std::pair<Value *, std::pair<int, int>> emptyPair(nullValue, emptyIntPair);
-            std::map<Value *, std::pair<int, int>> emptyMap;
+        // Type of a value, integers by bit width
+        static void hashType(MD5 *hash, Type *type)
+        {
+            hashInt(hash, type->getTypeID());
+            if (type->isIntegerTy())
+            {
+                hashInt(hash, type->getIntegerBitWidth());
+            }
+        }
 
-            // --- DATA STRUCTURES --- //
-            // Save cmp instructions to resolve on br instructions
-            std::map<Value *, CmpInst *> mapCmp;
+        // Operands: number of the block, argument or instruction, constants by value
+        void hashOperand(MD5 *hash, Value *operand) const
+        {
+            if (auto *BB = dyn_cast<BasicBlock>(operand))
+            {
+                hash->update("B");
+                hashInt(hash, blockIndex.lookup(BB));
+                return;
+            }
 
-            // List of basic blocks left to cycle
-            std::vector<BasicBlock *> workList;
+            DenseMap<const Value *, unsigned>::const_iterator valueIt = valueIndex.find(operand);
+            if (valueIt != valueIndex.end())
+            {
+                hash->update("V");
+                hashInt(hash, valueIt->second);
+                return;
+            }
 
-            // For each basic block, store list of ranges
-            // Contains list of value reference and current min and max range for that value
-            // {
-            //      "BB1": { '%k', { 0, 100 } }
-            // }
-            std::map<BasicBlock *, std::map<Value *, std::pair<int, int>>> listRange;
+            hashType(hash, operand->getType());
+            if (auto *constInt = dyn_cast<ConstantInt>(operand))
+            {
+                hash->update("I");
+                hash->update(toString(constInt->getValue(), 10, /* Signed */ true));
+            }
+            else if (auto *global = dyn_cast<GlobalValue>(operand))
+            {
+                hash->update("G");
+                hash->update(global->getName());
+            }
+            else if (isa<MetadataAsValue>(operand))
+            {
+                hash->update("M");
+            }
+            else
+            {
+                // Other constants (expressions, undef, null, floating point) by their text
+                std::string text;
+                raw_string_ostream textOS(text);
+                operand->printAsOperand(textOS, /* PrintType */ false);
+                hash->update("K");
+                hash->update(textOS.str());
+            }
+        }
 
-            // iterator_range<Argument> args = Func.args();
-            // for (Argument iter = args.begin(); iter != args.end(); iter++)
-            // {
-            //     errs() << "Param: " << iter.getName() << "\n";
-            // }
+        SmallString<128> path;
+        std::vector<BasicBlock *> blocks;
+        std::vector<Value *> values;
+        DenseMap<const BasicBlock *, unsigned> blockIndex;
+        DenseMap<const Value *, unsigned> valueIndex;
+        // Constant cmp operands: first cmp instruction (value number) and operand number
+        DenseMap<const Value *, std::pair<unsigned, unsigned>> constantOperand;
+    };
+
+    // Fixpoint of the branch range analysis, shared by the legacy and the new pass manager
+    struct BranchRangeSolver
+    {
+        // Phases timed (see RangePhase), not for functions analyzed concurrently: PhaseTimes is not thread-safe
+        bool isTimed = isTimingEnabled();
 
-            // --- ALGORITHM BEGIN --- //
-            // Entry basic block into workList (starting point)
-            workList.push_back(&Func.getEntryBlock());
+        // Run over a single function, ranges of the visited basic blocks stored in info
+        // With -branch-range-cache-dir the fixpoint only runs on a cache miss
+        void run(Function &Func, DominatorTree *domTree, BranchRangeInfo *info)
+        {
+            if (!CacheDir.empty())
+            {
+                RangeCache cache(Func);
+                if (cache.load(info))
+                {
+                    ++NumCacheHits;
+                    info->counters.cacheHits = 1;
+                    return;
+                }
+                ++NumCacheMisses;
+                compute(Func, domTree, info);
+                cache.store(*info);
+                info->counters.cacheMisses = 1;
+                return;
+            }
+            compute(Func, domTree, info);
+        }
 
-            // Loop on the worklist until all dependencies are resolved
-            while (workList.size() != 0 && iterLoops < maxLoops)
+        // previous/affected: incremental run, see update
+        void compute(Function &Func, DominatorTree *domTree, BranchRangeInfo *info, const BranchRangeInfo *previous = nullptr, const SmallPtrSetImpl<BasicBlock *> *affected = nullptr)
+        {
+            // Span of the function in the -ftime-trace/--time-trace output of clang and opt
+            TimeTraceScope timeScope("BranchRange", Func.getName());
+            if (StorageLayout == MapStorage)
+            {
+                MapRangeTable listRange(Func);
+                computeRanges(Func, &listRange, domTree, info, previous, affected);
+            }
+            else
             {
-                // Get next BasicBlock in workList and remove it
-                bool hasBeenUpdated = false;
-                ++iterLoops;
-                BasicBlock *BB = workList.at(0);
-                workList.erase(workList.begin());
-                errs() << "\n--- (" << iterLoops << ") " << BB->getName() << " ---\n";
+                DenseRangeTable listRange(Func);
+                computeRanges(Func, &listRange, domTree, info, previous, affected);
+            }
+        }
 
-                // --- PRINT ALL PREDECESSORS --- //
-                for (BasicBlock *Pred : predecessors(BB))
+        // Ranges of Func after a transform changed the given basic blocks, previous holding the ranges before
+        // Only the blocks reachable from a changed block can read a changed range: the fixpoint runs over
+        // them, the other visited blocks keep their ranges and executable edges from previous
+        void update(Function &Func, DominatorTree *domTree, const BranchRangeInfo &previous, ArrayRef<BasicBlock *> changedBlocks, BranchRangeInfo *info)
+        {
+            SmallPtrSet<BasicBlock *, 32> affected;
+            SmallVector<BasicBlock *, 32> reachable(changedBlocks.begin(), changedBlocks.end());
+            while (!reachable.empty())
+            {
+                BasicBlock *BB = reachable.pop_back_val();
+                if (affected.insert(BB).second)
                 {
-                    errs() << "..." << Pred->getName() << "\n";
+                    reachable.append(succ_begin(BB), succ_end(BB));
                 }
+            }
+            compute(Func, domTree, info, &previous, &affected);
+        }
 
-                // --- PRINT CURRENT VALUE RANGES INSIDE BLOCK --- //
-                if (isAlreadyVisited(BB, &listRange))
+        // Ranges and executable edges of the visited blocks outside affected copied from previous
+        // Returns the terminators branching from them into affected, where the worklist restarts
+        template <typename RangeTable>
+        std::vector<Instruction *> seedUnaffected(Function &Func, RangeTable *listRange, std::map<Value *, CmpInst *> *mapCmp, FixpointState *state, const BranchRangeInfo &previous, const SmallPtrSetImpl<BasicBlock *> &affected)
+        {
+            std::vector<Instruction *> border;
+            for (BasicBlock &BB : Func)
+            {
+                if (affected.count(&BB) || !previous.isVisited(&BB))
                 {
-                    std::map<Value *, std::pair<int, int>> refList = listRange.find(BB)->second;
-                    std::map<Value *, std::pair<int, int>>::iterator resIt;
-                    if (refList.begin() == refList.end())
-                    {
-                        errs() << "___No references\n";
-                    }
-                    for (resIt = refList.begin(); resIt != refList.end(); ++resIt)
-                    {
-                        errs() << "___" << resIt->first->getName() << printRange(resIt->second, infMin, infMax) << "\n";
-                    }
-                    errs() << "\n";
+                    continue;
                 }
-                else
+
+                listRange->markVisited(&BB);
+                for (const std::pair<Value *, Range> &valueRange : previous.getBlockRanges(&BB))
                 {
-                    errs() << "___No visited\n\n";
+                    listRange->setRange(&BB, valueRange.first, valueRange.second);
                 }
-
-                // If basic block not already visited, mark as visited
-                if (!isAlreadyVisited(BB, &listRange))
+                if (uint64_t tripcount = previous.getMaxTripcount(&BB))
                 {
-                    listRange.insert(std::pair<BasicBlock *, std::map<Value *, std::pair<int, int>>>(BB, emptyMap));
+                    state->tripcounts[&BB] = tripcount;
                 }
 
-                // Run over all instructions in the basic block
-                for (BasicBlock::InstListType::iterator it =
-                         BB->getInstList().begin();
-                     it != BB->getInstList().end(); ++it)
+                // Cmp instructions found (see evaluateInstruction), read by the branches of affected blocks
+                for (Instruction &I : BB)
                 {
-                    // Get instruction from iterator
-                    Instruction *I = &*it;
-                    if (auto *cmpInst = dyn_cast<CmpInst>(I)) // COMPLETE
+                    auto *cmpInst = dyn_cast<CmpInst>(&I);
+                    if (cmpInst != nullptr && (cmpInst->getOperand(0)->hasName() || cmpInst->getOperand(1)->hasName()))
                     {
-                        errs() << "@Cmp\n";
-                        // Cmp information needed only when at least one reference
-                        if (cmpInst->getOperand(0)->hasName() || cmpInst->getOperand(1)->hasName())
-                        {
-                            if (mapCmp.find(cmpInst) == mapCmp.end())
-                            {
-                                errs() << "NEW: " << cmpInst->getName() << "\n\n";
-                                std::pair<Value *, CmpInst *> newCmpInst(cmpInst, cmpInst);
-                                mapCmp.insert(newCmpInst);
-                            }
-                        }
+                        mapCmp->insert(std::make_pair(cmpInst, cmpInst));
                     }
-                    else if (auto *callInst = dyn_cast<CallInst>(I))
+                }
+
+                bool isBorder = false;
+                for (BasicBlock *succ : successors(&BB))
+                {
+                    if (!previous.isExecutableEdge(&BB, succ))
                     {
-                        errs() << "@Call\n";
-                        for (unsigned args = 0; args < callInst->getNumArgOperands(); ++args)
-                        {
-                            Value *argOper = callInst->getArgOperand(args);
-                            if (argOper->hasName())
-                            {
-                                errs() << "Unknown range on " << argOper->getName() << "(" << args << ")\n";
-                            }
-                        }
+                        continue;
                     }
-                    else if (auto *loadInst = dyn_cast<LoadInst>(I))
+                    if (affected.count(succ))
                     {
-                        errs() << "@Load\n";
-                        errs() << loadInst->getPointerOperand()->getName() << "\n";
-                        errs() << loadInst->getName() << "\n";
+                        isBorder = true;
                     }
-                    else if (auto *selectInst = dyn_cast<SelectInst>(I))
+                    else
                     {
-                        errs() << "@Select\n";
-                        errs() << "Condition: " << selectInst->getCondition()->getName() << "\n";
-                        errs() << "True: " << selectInst->getTrueValue()->getName() << "\n";
-                        errs() << "False: " << selectInst->getFalseValue()->getName() << "\n";
+                        state->executableEdges.insert(std::make_pair(&BB, succ));
                     }
-                    else if (auto *operInst = dyn_cast<BinaryOperator>(I))
-                    {
-                        errs() << "@Operation\n";
-                        // Get operands from binary operation
-                        Value *oper0 = operInst->getOperand(0);
-                        Value *oper1 = operInst->getOperand(1);
-                        unsigned operCode = operInst->getOpcode();
-                        std::pair<int, int> rangeRef(infMin, infMax);
-
-                        if (ConstantInt *CI0 = dyn_cast<ConstantInt>(oper0))
-                        {
-                            int constValue0 = CI0->getZExtValue();
+                }
+                if (isBorder)
+                {
+                    border.push_back(BB.getTerminator());
+                }
+            }
 
-                            // a = 1 + 1 (constant)
-                            if (ConstantInt *CI1 = dyn_cast<ConstantInt>(oper1))
-                            {
-                                int constValue1 = CI1->getZExtValue();
-                                int totConst = binaryOperationResult(operCode, constValue0, constValue1);
-                                rangeRef.first = totConst;
-                                rangeRef.second = totConst;
-                            }
-                            // a = 1 + b
-                            else
-                            {
-                                std::pair<int, int> valueRef = getValueReference(BB, oper1, &listRange, infMin, infMax)->second;
-                                errs() << operInst->getName() << " = " << oper1->getName() << printRange(valueRef, infMin, infMax) << " | " << constValue0 << " [" << BB->getName() << "]\n";
+            return border;
+        }
 
-                                if (valueRef.first != infMin)
-                                {
-                                    rangeRef.first = binaryOperationResult(operCode, constValue0, valueRef.first);
-                                }
-                                else
-                                {
-                                    rangeRef.first = infMin;
-                                }
-                                if (valueRef.second != infMax)
-                                {
-                                    rangeRef.second = binaryOperationResult(operCode, constValue0, valueRef.second);
-                                }
-                                else
-                                {
-                                    rangeRef.second = infMax;
-                                }
-                            }
-                        }
-                        else if (ConstantInt *CI1 = dyn_cast<ConstantInt>(oper1))
-                        {
-                            int constValue1 = CI1->getZExtValue();
+        // Compute value ranges for each basic block, stored inside listRange and copied to info
+        // Incremental run (previous and affected given): only the affected blocks are evaluated, from the
+        // branches entering them (see seedUnaffected)
+        template <typename RangeTable>
+        void computeRanges(Function &Func, RangeTable *listRange, DominatorTree *domTree, BranchRangeInfo *info, const BranchRangeInfo *previous, const SmallPtrSetImpl<BasicBlock *> *affected)
+        {
+            // --- PLACEHOLDERS/DEFAULTS --- //
+            // Nothing is created in the LLVMContext: functions of a module are analyzed concurrently
+            int iterLoops = 0;
 
-                            // a = b + 1
-                            if (oper0->hasName())
-                            {
-                                std::pair<int, int> valueRef = getValueReference(BB, oper0, &listRange, infMin, infMax)->second;
-                                errs() << operInst->getName() << " = " << oper0->getName() << printRange(valueRef, infMin, infMax) << " | " << constValue1 << " [" << BB->getName() << "]\n";
+            // --- DATA STRUCTURES --- //
+            // Save cmp instructions to resolve on br instructions
+            std::map<Value *, CmpInst *> mapCmp;
 
-                                if (valueRef.first != infMin)
-                                {
-                                    rangeRef.first = binaryOperationResult(operCode, valueRef.first, constValue1);
-                                }
-                                else
-                                {
-                                    rangeRef.first = infMin;
-                                }
-                                if (valueRef.second != infMax)
-                                {
-                                    rangeRef.second = binaryOperationResult(operCode, valueRef.second, constValue1);
-                                }
-                                else
-                                {
-                                    rangeRef.second = infMax;
-                                }
-                            }
-                        }
-                        // a = b + c
-                        else
-                        {
-                            // a = b + c
-                            if (oper0->hasName() && oper1->hasName())
-                            {
-                                errs() << "BOTH REF: " << oper0->getName() << ", " << oper1->getName() << "\n";
-                            }
-                            // a = b + [%0]
-                            else if (oper0->hasName())
-                            {
-                                if (ConstantInt *CI = dyn_cast<ConstantInt>(oper1))
-                                {
-                                    errs() << "BOTH REF: " << oper0->getName() << ", " << CI->getZExtValue() << "\n";
-                                }
-                            }
-                            // a = [%0] + b
-                            else if (oper1->hasName())
-                            {
-                                if (ConstantInt *CI = dyn_cast<ConstantInt>(oper0))
-                                {
-                                    errs() << "BOTH REF: " << CI->getZExtValue() << ", " << oper1->getName() << "\n";
-                                }
-                            }
-                            // a = [%0] + [%1]
-                            else
-                            {
-                                if (ConstantInt *CI0 = dyn_cast<ConstantInt>(oper0))
-                                {
-                                    if (ConstantInt *CI1 = dyn_cast<ConstantInt>(oper0))
-                                    {
-                                        errs() << "BOTH REF: " << CI0->getZExtValue() << ", " << CI1->getZExtValue() << "\n";
-                                    }
-                                }
-                            }
-                        }
+            // List of basic blocks (dense) or instructions (sparse) left to cycle
+            FixpointEngine engine(Func, EngineMode, WorkListMode);
 
-                        std::pair<Value *, std::pair<int, int>> rangePair(operInst, rangeRef);
-                        errs() << "NEW: " << operInst->getName() << printRange(rangeRef, infMin, infMax) << "\n";
-                        if (hasValueReference(BB, operInst, &listRange))
-                        {
-                            // Add to worklist if range has been updated
-                            std::pair<int, int> valRefSource = getValueReference(BB, operInst, &listRange, infMin, infMax)->second;
-                            hasBeenUpdated = valRefSource.first != rangeRef.first || valRefSource.second != rangeRef.second;
+            // Spans of the worklist iterations, added to the trace at the end (-branch-range-time-trace)
+            std::vector<TraceSpan> spans;
+            std::vector<TraceSpan> *traceSpans = TimeTraceFile.empty() ? nullptr : &spans;
+            TraceClock::time_point funcStart = TraceClock::now();
 
-                            listRange.find(BB)->second.find(operInst)->second.first = rangeRef.first;
-                            listRange.find(BB)->second.find(operInst)->second.second = rangeRef.second;
-                        }
-                        else
+            // Loop headers and cmp thresholds of the widening, executable edges
+            FixpointState state;
+            state.domTree = domTree;
+            collectWideningPoints(Func, &state);
+
+            // --- ALGORITHM BEGIN --- //
+            // Entry basic block into workList (starting point)
+            std::vector<Instruction *> border;
+            if (previous != nullptr)
+            {
+                border = seedUnaffected(Func, listRange, &mapCmp, &state, *previous, *affected);
+                for (Instruction *borderInst : border)
+                {
+                    engine.pushInstruction(borderInst);
+                }
+            }
+            if (previous == nullptr || affected->count(&Func.getEntryBlock()))
+            {
+                listRange->markVisited(&Func.getEntryBlock());
+                engine.pushBlock(&Func.getEntryBlock());
+            }
+
+            // Phase 0: ascending (widening), phase 1: narrowing of every visited basic block
+            for (int phase = 0; phase < 2; ++phase)
+            {
+                if (phase == 1)
+                {
+                    TRACE(1, errs() << "\n--- NARROWING ---\n");
+                    state.isNarrowing = true;
+                    for (BasicBlock &BB : Func)
+                    {
+                        if (isAlreadyVisited(&BB, listRange) && (previous == nullptr || affected->count(&BB)))
                         {
-                            // Added value reference, add basic block in worklist
-                            hasBeenUpdated = true;
-                            listRange.find(BB)->second.insert(rangePair);
+                            engine.pushBlock(&BB);
                         }
                     }
-                    else if (auto *brInst = dyn_cast<BranchInst>(I))
+                    for (Instruction *borderInst : border)
                     {
-                        // If no 'if', 'while', 'for' (only one br basic block)
-                        if (brInst->isUnconditional())
-                        {
-                            errs() << "@Br-Simple\n";
-                            BasicBlock *succ = brInst->getSuccessor(0);
-
-                            for (BasicBlock *Pred : predecessors(BB))
-                            {
-                                if (Pred == succ)
-                                {
-                                    errs() << "LOOP on " << Pred->getName() << "\n";
-                                }
-                            }
-
-                            applySimpleBr(hasBeenUpdated, succ, &listRange, &workList, emptyMap);
-                        }
-                        else
-                        {
-                            errs() << "@Br-Complex\n";
-                            errs() << "Condition: " << brInst->getCondition()->getName() << "\n\n";
-
-                            // Successor basic blocks (taken and not taken)
-                            BasicBlock *succ0 = brInst->getSuccessor(0);
-                            BasicBlock *succ1 = brInst->getSuccessor(1);
-
-                            // Get previous cmp values
-                            CmpInst *cmpInst = mapCmp.find(brInst->getCondition())->second;
-                            ICmpInst::Predicate pred = cmpInst->getPredicate();
-                            Value *oper0 = cmpInst->getOperand(0);
-                            Value *oper1 = cmpInst->getOperand(1);
-
-                            // Default new range pairs and value
-                            // VAL1: Range of the cmp instruction for branch taken
-                            std::pair<int, int> rangeCmpTaken(infMin, infMax);
-                            // VAL2: Range of the cmp instruction for branch not taken
-                            std::pair<int, int> rangeCmpNotTaken(infMin, infMax);
-                            Value *oper = oper0;
-
-                            // a < b
-                            if (oper0->hasName() && oper1->hasName())
-                            {
-                                errs() << "\n\nUNEXPECTED DOUBLE REFERENCE CMP INSTRUCTION\n\n";
-                            }
-                            // a < 1
-                            else if (oper0->hasName())
-                            {
-                                // Select reference to operand0
-                                oper = oper0;
+                        engine.pushInstruction(borderInst);
+                    }
+                }
 
-                                if (ConstantInt *CI = dyn_cast<ConstantInt>(oper1))
-                                {
-                                    // Change range of successors based on reference, constant value, and predicate
-                                    computeCmpRange(true, pred, oper, CI->getZExtValue(), &rangeCmpTaken, &rangeCmpNotTaken);
-                                }
-                            }
-                            // 1 < a
-                            else
-                            {
-                                // Select reference to operand0
-                                oper = oper1;
+                if (engine.isSparse())
+                {
+                    // Loop on the worklist until no range changes anymore
+                    while (!engine.empty())
+                    {
+                        ++iterLoops;
+                        Instruction *I = engine.popInstruction();
+                        IterationScope iterationScope(traceSpans, phase == 0 ? "Widening iteration" : "Narrowing iteration", I->getParent(), iterLoops, engine.counters);
+                        TRACE(1, errs() << "\n--- (" << iterLoops << ") " << I->getParent()->getName() << ": " << I->getOpcodeName() << " " << I->getName() << " ---\n");
 
-                                if (ConstantInt *CI = dyn_cast<ConstantInt>(oper0))
-                                {
-                                    // Change range of successors based on reference, constant value, and predicate
-                                    computeCmpRange(false, pred, oper, CI->getZExtValue(), &rangeCmpTaken, &rangeCmpNotTaken);
-                                }
-                            }
+                        evaluateInstruction(I, I->getParent(), listRange, &mapCmp, &engine, &state);
+                    }
+                    continue;
+                }
 
-                            // VAL3: Range in current basic block of the variable in the cmp instruction
-                            std::map<Value *, std::pair<int, int>>::iterator valRefSource = getValueReference(BB, oper, &listRange, infMin, infMax);
-                            // VAL4: Range in taken basic block of the variable in the cmp instruction
-                            std::map<Value *, std::pair<int, int>>::iterator valBranchTaken = getValueReference(succ0, oper, &listRange, infMin, infMax);
-                            // VAL5: Range in not taken basic block of the variable in the cmp instruction
-                            std::map<Value *, std::pair<int, int>>::iterator valBranchNotTaken = getValueReference(succ1, oper, &listRange, infMin, infMax);
+                // Loop on the worklist until all dependencies are resolved
+                while (!engine.empty())
+                {
+                    // Get next BasicBlock in workList and remove it
+                    ++iterLoops;
+                    BasicBlock *BB = engine.popBlock();
+                    IterationScope iterationScope(traceSpans, phase == 0 ? "Widening iteration" : "Narrowing iteration", BB, iterLoops, engine.counters);
+                    TRACE(1, errs() << "\n--- (" << iterLoops << ") " << BB->getName() << " ---\n");
+
+                    // --- PRINT ALL PREDECESSORS AND CURRENT VALUE RANGES INSIDE BLOCK --- //
+                    TRACE(2, printBlockRanges(BB, listRange));
+
+                    // Run over all instructions in the basic block
+                    for (BasicBlock::InstListType::iterator it =
+                             BB->getInstList().begin();
+                         it != BB->getInstList().end(); ++it)
+                    {
+                        // Get instruction from iterator
+                        Instruction *I = &*it;
+                        evaluateInstruction(I, BB, listRange, &mapCmp, &engine, &state);
+                        TRACE(2, errs() << "\n");
+                    }
+                }
+            }
 
-                            // Final computed branch ranges
-                            std::pair<int, int> rangeBranchTaken = brOpe(valRefSource->second, valBranchTaken->second, rangeCmpTaken);
-                            std::pair<int, int> rangeBranchNotTaken = brOpe(valRefSource->second, valBranchNotTaken->second, rangeCmpNotTaken);
+            // --- COPY FOUND RANGES FOR EACH BASIC BLOCK VISITED --- //
+            for (BasicBlock &BB : Func)
+            {
+                if (!isAlreadyVisited(&BB, listRange))
+                {
+                    continue;
+                }
 
-                            errs() << valRefSource->first->getName() << printRange(valRefSource->second, infMin, infMax) << " "
-                                   << valBranchTaken->first->getName() << printRange(valBranchTaken->second, infMin, infMax) << " "
-                                   << printRange(rangeCmpTaken, infMin, infMax) << "\n";
+                info->addBlock(&BB);
+                listRange->forEachRange(&BB, [&](Value *ref, Range range) {
+                    info->addRange(&BB, ref, range);
+                });
+                for (BasicBlock *succ : successors(&BB))
+                {
+                    if (state.executableEdges.count(std::make_pair(&BB, succ)))
+                    {
+                        info->addEdge(&BB, succ);
+                    }
+                }
+                if (uint64_t tripcount = state.tripcounts.lookup(&BB))
+                {
+                    info->addTripcount(&BB, tripcount);
+                }
+            }
 
-                            errs() << valRefSource->first->getName() << printRange(valRefSource->second, infMin, infMax) << " "
-                                   << valBranchNotTaken->first->getName() << printRange(valBranchNotTaken->second, infMin, infMax) << " "
-                                   << printRange(rangeCmpNotTaken, infMin, infMax) << "\n";
+            info->counters = engine.counters;
+            info->counters.iterations = iterLoops;
+            NumBlockVisits += engine.counters.blockVisits;
+            NumReenqueues += engine.counters.reenqueues;
+            NumRangeUpdates += engine.counters.updates;
+            NumWidenings += engine.counters.widenings;
+            NumValuesToTop += engine.counters.valuesToTop;
 
-                            // Check for new range and add it in case of updates
-                            errs() << succ0->getName() << ": " << printRange(rangeBranchTaken, infMin, infMax) << "\n";
-                            errs() << succ1->getName() << ": " << printRange(rangeBranchNotTaken, infMin, infMax) << "\n\n";
+            if (traceSpans != nullptr)
+            {
+                worklistTrace->addFunction(TraceSpan{"Branch range", Func.getName().str(), funcStart, TraceClock::now(), true, unsigned(iterLoops), engine.counters.updates},
+                                           std::move(spans));
+            }
+        }
 
-                            // Check successor0 if already visited
-                            applySimpleBr(true, succ0, &listRange, &workList, emptyMap);
-                            applySimpleBr(true, succ1, &listRange, &workList, emptyMap);
+        // Apply the transfer function of a single instruction inside basic block BB
+        template <typename RangeTable>
+        void evaluateInstruction(Instruction *I, BasicBlock *BB, RangeTable *listRange, std::map<Value *, CmpInst *> *mapCmp, FixpointEngine *engine, FixpointState *state)
+        {
+            engine->beginEvaluation(I);
+            PhaseRegion phaseRegion(isa<PHINode>(I) ? PhiPhase : I->isTerminator() ? BranchPhase : TransferPhase, isTimed);
 
-                            // Update/Insert new range in successors basic blocks
-                            updateValueReference(succ0, oper, rangeBranchTaken, &listRange, infMin, infMax);
-                            updateValueReference(succ1, oper, rangeBranchNotTaken, &listRange, infMin, infMax);
-                        }
+            if (auto *cmpInst = dyn_cast<CmpInst>(I)) // COMPLETE
+            {
+                TRACE(2, errs() << "@Cmp\n");
+                // Cmp information needed only when at least one reference
+                if (cmpInst->getOperand(0)->hasName() || cmpInst->getOperand(1)->hasName())
+                {
+                    if (mapCmp->find(cmpInst) == mapCmp->end())
+                    {
+                        TRACE(1, errs() << "NEW: " << cmpInst->getName() << "\n\n");
+                        std::pair<Value *, CmpInst *> newCmpInst(cmpInst, cmpInst);
+                        mapCmp->insert(newCmpInst);
+                        engine->update(BB, cmpInst);
                     }
-                    else if (auto *phiInst = dyn_cast<PHINode>(I))
+                }
+            }
+            else if (auto *callInst = dyn_cast<CallInst>(I))
+            {
+                TRACE(2, errs() << "@Call\n");
+                for (unsigned args = 0; args < callInst->arg_size(); ++args)
+                {
+                    Value *argOper = callInst->getArgOperand(args);
+                    if (argOper->hasName())
                     {
-                        // General ranges and values
-                        Value *operand0 = phiInst->getOperand(0);
-                        Value *operand1 = phiInst->getOperand(1);
+                        TRACE(2, errs() << "Unknown range on " << argOper->getName() << "(" << args << ")\n");
+                    }
+                }
+            }
+            else if (auto *loadInst = dyn_cast<LoadInst>(I))
+            {
+                TRACE(2, errs() << "@Load\n");
+                TRACE(2, errs() << loadInst->getPointerOperand()->getName() << "\n");
+                TRACE(2, errs() << loadInst->getName() << "\n");
+            }
+            else if (auto *selectInst = dyn_cast<SelectInst>(I))
+            {
+                TRACE(2, errs() << "@Select\n");
+                TRACE(2, errs() << "Condition: " << selectInst->getCondition()->getName() << "\n");
+                TRACE(2, errs() << "True: " << selectInst->getTrueValue()->getName() << "\n");
+                TRACE(2, errs() << "False: " << selectInst->getFalseValue()->getName() << "\n");
+            }
+            else if (auto *operInst = dyn_cast<BinaryOperator>(I))
+            {
+                TRACE(2, errs() << "@Operation\n");
+                // Integer operations only (no range for floating point values)
+                if (!operInst->getType()->isIntegerTy())
+                {
+                    return;
+                }
 
-                        BasicBlock *BB0 = phiInst->getIncomingBlock(0);
-                        BasicBlock *BB1 = phiInst->getIncomingBlock(1);
+                // Get operands from binary operation
+                // a = 1 + 1, a = b + 1, a = 1 + b, a = b + c (unnamed operands are unknown)
+                Value *oper0 = operInst->getOperand(0);
+                Value *oper1 = operInst->getOperand(1);
+                Range range0 = getOperandRange(BB, oper0, listRange, engine, state);
+                Range range1 = getOperandRange(BB, oper1, listRange, engine, state);
+                Range rangeRef = binaryOperationResult(operInst, range0, range1);
+                TRACE(2, errs() << operInst->getName() << " = " << oper0->getName() << printRange(range0) << " " << operInst->getOpcodeName()
+                                << " " << oper1->getName() << printRange(range1) << " [" << BB->getName() << "]\n");
+
+                updateValueReference(BB, operInst, rangeRef, listRange, engine, state);
+            }
+            else if (auto *brInst = dyn_cast<BranchInst>(I))
+            {
+                // If no 'if', 'while', 'for' (only one br basic block)
+                if (brInst->isUnconditional())
+                {
+                    TRACE(2, errs() << "@Br-Simple\n");
+                    BasicBlock *succ = brInst->getSuccessor(0);
 
-                        int search0 = searchInBasicBlock(phiInst, BB0, operand0);
-                        int search1 = searchInBasicBlock(phiInst, BB1, operand1);
+                    TRACE(2, if (is_contained(predecessors(BB), succ)) {
+                        errs() << "LOOP on " << succ->getName() << "\n";
+                    });
 
-                        // Range of the phi variable in current basic block
-                        std::map<Value *, std::pair<int, int>>::iterator valRefSource = getValueReference(BB, phiInst, &listRange, infMin, infMax);
-                        std::pair<int, int> phiPair(infMin, infMax);
+                    applySimpleBr(BB, succ, listRange, engine, state);
+                }
+                else
+                {
+                    TRACE(2, errs() << "@Br-Complex\n");
+                    TRACE(2, errs() << "Condition: " << brInst->getCondition()->getName() << "\n\n");
 
-                        errs() << "@Phi: " << phiInst->getName() << " (" << operand0->getName() << "[" << BB0->getName() << "], " << operand1->getName() << " [" << BB1->getName() << "])\n";
+                    // Successor basic blocks (taken and not taken)
+                    BasicBlock *succ0 = brInst->getSuccessor(0);
+                    BasicBlock *succ1 = brInst->getSuccessor(1);
 
-                        // Both referenced values
-                        if (operand0->hasName() && operand1->hasName())
-                        {
-                            std::map<Value *, std::pair<int, int>>::iterator valRef0 = getValueReference(BB0, operand0, &listRange, infMin, infMax);
-                            std::map<Value *, std::pair<int, int>>::iterator valRef1 = getValueReference(BB1, operand1, &listRange, infMin, infMax);
+                    // Condition not computed by a cmp instruction, no range to refine: both successors reached
+                    if (!hasCmpReference(brInst->getCondition(), mapCmp, engine))
+                    {
+                        applySimpleBr(BB, succ0, listRange, engine, state);
+                        applySimpleBr(BB, succ1, listRange, engine, state);
+                        return;
+                    }
 
-                            // Apply phi combine operation
-                            errs() << valRefSource->first->getName() << printRange(valRefSource->second, infMin, infMax) << " "
-                                   << valRef0->first->getName() << printRange(valRef0->second, infMin, infMax) << " "
-                                   << valRef1->first->getName() << printRange(valRef1->second, infMin, infMax) << "\n";
+                    // VAL1: Range of the cmp instruction for branch taken
+                    Range rangeCmpTaken;
+                    // VAL2: Range of the cmp instruction for branch not taken
+                    Range rangeCmpNotTaken;
+                    Value *oper = getBranchRanges(mapCmp->find(brInst->getCondition())->second, &rangeCmpTaken, &rangeCmpNotTaken);
+                    if (oper == nullptr)
+                    {
+                        applySimpleBr(BB, succ0, listRange, engine, state);
+                        applySimpleBr(BB, succ1, listRange, engine, state);
+                        return;
+                    }
 
-                            phiPair = phiOpe(valRefSource->second, valRef0->second, valRef1->second);
-                        }
-                        // Operator1 is known reference, Operator0 is constant
-                        else if (!operand0->hasName() && operand1->hasName())
-                        {
-                            std::pair<int, int> constPair = getConstantPair(operand0, infMin, infMax);
-                            std::map<Value *, std::pair<int, int>>::iterator valRef = getValueReference(BB1, operand1, &listRange, infMin, infMax);
+                    // Infeasible edge: the range of the operand in BB is empty on it (-branch-range-prune-edges)
+                    // Not taken while the range keeps it empty, the branch is evaluated again when the range grows
+                    Range valRefSource = getValueReference(BB, oper, listRange, engine, state);
+                    bool isTaken0 = !PruneEdges || !isEmptyRange(brOpe(valRefSource, rangeCmpTaken));
+                    bool isTaken1 = !PruneEdges || !isEmptyRange(brOpe(valRefSource, rangeCmpNotTaken));
+                    if (isTaken0 || (succ0 == succ1 && isTaken1))
+                    {
+                        applySimpleBr(BB, succ0, listRange, engine, state);
+                    }
+                    if (isTaken1 || (succ0 == succ1 && isTaken0))
+                    {
+                        applySimpleBr(BB, succ1, listRange, engine, state);
+                    }
 
-                            // Apply phi combine operation
-                            errs() << valRefSource->first->getName() << printRange(valRefSource->second, infMin, infMax) << " "
-                                   << printRange(constPair, infMin, infMax) << " "
-                                   << valRef->first->getName() << printRange(valRef->second, infMin, infMax) << "\n";
+                    // Final computed branch ranges, joined with the other edges entering the successors
+                    Range rangeBranchTaken = getIncomingRange(succ0, oper, listRange, mapCmp, engine, state);
+                    Range rangeBranchNotTaken = getIncomingRange(succ1, oper, listRange, mapCmp, engine, state);
 
-                            phiPair = phiOpe(valRefSource->second, constPair, valRef->second);
+                    TRACE(2, errs() << oper->getName() << " " << printRange(rangeCmpTaken) << " "
+                                    << printRange(rangeCmpNotTaken) << "\n");
 
-                            // Check if the constant operand is the minimum or maximum value
-                            if (ConstantInt *CI = dyn_cast<ConstantInt>(operand0))
-                            {
-                                int constRangeVal = CI->getZExtValue();
+                    TRACE(2, errs() << succ0->getName() << ": " << printRange(rangeBranchTaken) << "\n");
+                    TRACE(2, errs() << succ1->getName() << ": " << printRange(rangeBranchNotTaken) << "\n\n");
 
-                                if (search1 == 1)
-                                {
-                                    phiPair.first = constRangeVal;
-                                    maxTripcount(&phiPair, constRangeVal, phiInst, BB1, operand1, &mapCmp, &listRange, infMin, infMax);
-                                }
-                                else if (search1 == 2)
-                                {
-                                    phiPair.second = constRangeVal;
-                                    maxTripcount(&phiPair, constRangeVal, phiInst, BB1, operand1, &mapCmp, &listRange, infMin, infMax);
-                                }
-                            }
-                        }
-                        // Operator0 is known reference, Operator1 is constant
-                        else if (!operand1->hasName() && operand0->hasName())
-                        {
-                            std::pair<int, int> constPair = getConstantPair(operand1, infMin, infMax);
-                            std::map<Value *, std::pair<int, int>>::iterator valRef = getValueReference(BB0, operand0, &listRange, infMin, infMax);
+                    // Update/Insert new range in successors basic blocks
+                    // (not where the variable is defined, the range there is its definition, nor in a block not reached yet)
+                    if (!isDefinedIn(oper, succ0) && isAlreadyVisited(succ0, listRange))
+                    {
+                        updateValueReference(succ0, oper, rangeBranchTaken, listRange, engine, state);
+                    }
+                    if (!isDefinedIn(oper, succ1) && isAlreadyVisited(succ1, listRange))
+                    {
+                        updateValueReference(succ1, oper, rangeBranchNotTaken, listRange, engine, state);
+                    }
+                }
+            }
+            else if (auto *phiInst = dyn_cast<PHINode>(I))
+            {
+                TRACE(2, {
+                    errs() << "@Phi: " << phiInst->getName() << " (";
+                    for (unsigned inc = 0; inc < phiInst->getNumIncomingValues(); ++inc)
+                    {
+                        errs() << (inc == 0 ? "" : ", ") << phiInst->getIncomingValue(inc)->getName() << "[" << phiInst->getIncomingBlock(inc)->getName() << "]";
+                    }
+                    errs() << ")\n";
+                });
 
-                            // Apply phi combine operation
-                            errs() << valRefSource->first->getName() << printRange(valRefSource->second, infMin, infMax) << " "
-                                   << valRef->first->getName() << printRange(valRef->second, infMin, infMax) << " "
-                                   << printRange(constPair, infMin, infMax) << "\n";
+                // Integer phi only (no range for pointers and floating point values)
+                if (!phiInst->getType()->isIntegerTy())
+                {
+                    return;
+                }
 
-                            phiPair = phiOpe(valRefSource->second, valRef->second, constPair);
+                // Join of the ranges along the executable incoming edges (empty when none is taken yet)
+                Range phiPair = BranchRangeInfo::getEmptyRange(phiInst->getType()->getIntegerBitWidth());
+                for (unsigned inc = 0; inc < phiInst->getNumIncomingValues(); ++inc)
+                {
+                    Value *operand = phiInst->getIncomingValue(inc);
+                    BasicBlock *incBB = phiInst->getIncomingBlock(inc);
+                    if (!isExecutableEdge(incBB, BB, engine, state))
+                    {
+                        continue;
+                    }
 
-                            // Check if the constant operand is the minimum or maximum value
-                            if (ConstantInt *CI = dyn_cast<ConstantInt>(operand1))
-                            {
-                                int constRangeVal = CI->getZExtValue();
+                    Range valRef = operand->hasName() ? getValueReference(incBB, operand, listRange, engine, state) : getConstantPair(operand);
+                    TRACE(2, errs() << operand->getName() << printRange(valRef) << " ");
+                    phiPair = phiOpe(phiPair, valRef);
+                }
+                TRACE(2, errs() << "\n");
 
-                                if (search0 == 1)
-                                {
-                                    phiPair.first = constRangeVal;
-                                    maxTripcount(&phiPair, constRangeVal, phiInst, BB0, operand0, &mapCmp, &listRange, infMin, infMax);
-                                }
-                                else if (search0 == 2)
-                                {
-                                    phiPair.second = constRangeVal;
-                                    maxTripcount(&phiPair, constRangeVal, phiInst, BB0, operand0, &mapCmp, &listRange, infMin, infMax);
-                                }
-                            }
+                // a = phi [ 0, entry ], [ a.next, loop ]: the constant operand is the minimum or maximum value
+                if (phiInst->getNumIncomingValues() == 2 && !isEmptyRange(phiPair))
+                {
+                    for (unsigned inc = 0; inc < 2; ++inc)
+                    {
+                        ConstantInt *CI = dyn_cast<ConstantInt>(phiInst->getIncomingValue(inc));
+                        Value *operand = phiInst->getIncomingValue(1 - inc);
+                        BasicBlock *opBB = phiInst->getIncomingBlock(1 - inc);
+                        if (CI == nullptr || !operand->hasName())
+                        {
+                            continue;
                         }
-                        // Both integers
-                        else if (!operand0->hasName() && !operand1->hasName())
+
+                        const APInt &constRangeVal = CI->getValue();
+                        int search = searchInBasicBlock(phiInst, opBB, operand);
+                        if (search == 1)
                         {
-                            // TODO: Phi of two constant values (is it possible?)
-                            errs() << "\n\nTWO INTEGERS\n\n";
+                            phiPair.first = constRangeVal;
                         }
-                        else
+                        else if (search == 2)
                         {
-                            errs() << "\n\nUNEXPECTED SITUATION!\n\n";
+                            phiPair.second = constRangeVal;
                         }
 
-                        // Update/Insert new phi range to the value in the current basic block
-                        if (phiInst->hasName())
+                        // Bound from the tripcount of the loop, once the loop ranges are stable
+                        if (search != 0 && state->isNarrowing)
                         {
-                            updateValueReference(BB, phiInst, phiPair, &listRange, infMin, infMax);
+                            Range tripPair = phiPair;
+                            PhaseRegion tripcountRegion(TripcountPhase, isTimed);
+                            maxTripcount(&tripPair, constRangeVal, phiInst, opBB, operand, mapCmp, listRange, engine, state);
+                            phiPair = interOpe(phiPair, tripPair);
                         }
                     }
-
-                    errs() << "\n";
                 }
-            }
 
-            // --- PRINT FOUND RANGES FOR EACH BASIC BLOCK VISITED --- //
-            if (iterLoops == maxLoops)
-            {
-                errs() << "--- (MAX ITERATIONS LIMIT) ---\n";
+                // Update/Insert new phi range to the value in the current basic block
+                if (phiInst->hasName())
+                {
+                    updateValueReference(BB, phiInst, phiPair, listRange, engine, state);
+                }
             }
-            errs() << "--- VALUE-RANGES ---\n";
-            std::map<BasicBlock *, std::map<Value *, std::pair<int, int>>>::iterator resIt;
-            for (resIt = listRange.begin(); resIt != listRange.end(); ++resIt)
+            else if (I->isTerminator())
             {
-                errs() << "BB: " << resIt->first->getName() << "\n";
-                std::map<Value *, std::pair<int, int>> listBB = resIt->second;
-                while (!listBB.empty())
+                // Switch, invoke, ...: every successor is reached, no range to refine
+                TRACE(2, errs() << "@Terminator\n");
+                for (BasicBlock *succ : successors(BB))
                 {
-                    std::map<Value *, std::pair<int, int>>::iterator pairBB = listBB.begin();
-                    int intRange = pairBB->second.first == infMin || pairBB->second.second == infMax ? infMax : std::abs(pairBB->second.second - pairBB->second.first) + 1;
-                    int numOfBit = intRange == infMax ? 32 : std::ceil(intRange <= 2 ? 1 : std::log2(intRange)) + 1;
-                    errs() << "   " << pairBB->first->getName() << printRange(pairBB->second, infMin, infMax) << " = ";
-
-                    if (pairBB->second.first != infMin && pairBB->second.second != infMax)
-                    {
-                        errs() << intRange << " {" << numOfBit << "bit}\n";
-                    }
-                    else
-                    {
-                        errs() << "MAX\n";
-                    }
-                    listBB.erase(listBB.begin());
+                    applySimpleBr(BB, succ, listRange, engine, state);
                 }
-                errs() << "\n";
             }
-
-            return false;
         }
 
         // Compute and update maximum range of value add/sub in a loop
-        void maxTripcount(std::pair<int, int> *tripPair, int baseVal, Value *inst, BasicBlock *BB, Value *operand, std::map<Value *, CmpInst *> *mapCmp, std::map<BasicBlock *, std::map<Value *, std::pair<int, int>>> *listRange, int infMin, int infMax)
+        // Computed in a width holding base + step * tripcount without overflow, no bound when it exceeds the width of the value
+        template <typename RangeTable>
+        void maxTripcount(Range *tripPair, const APInt &baseVal, Value *inst, BasicBlock *BB, Value *operand, std::map<Value *, CmpInst *> *mapCmp, RangeTable *listRange, FixpointEngine *engine, FixpointState *state)
         {
-            int tripcount = -1;
+            // Number of values of the loop condition range (0 when unknown)
+            APInt tripcount;
 
             for (BasicBlock::InstListType::iterator loopIt =
                      BB->getInstList().begin();
@@ -563,128 +1721,83 @@ namespace
                                             BasicBlock *succ0 = brInst->getSuccessor(0);
                                             // BasicBlock *succ1 = brInst->getSuccessor(1);
 
-                                            // Get previous cmp values
-                                            CmpInst *cmpInst = mapCmp->find(brInst->getCondition())->second;
-                                            ICmpInst::Predicate pred = cmpInst->getPredicate();
-                                            Value *oper0 = cmpInst->getOperand(0);
-                                            Value *oper1 = cmpInst->getOperand(1);
-
-                                            // Default new range pairs and value
-                                            // VAL1: Range of the cmp instruction for branch taken
-                                            std::pair<int, int> rangeCmpTaken(infMin, infMax);
-                                            std::pair<int, int> rangeCmpNotTaken(infMin, infMax);
-                                            Value *oper = oper0;
-
-                                            // a < b
-                                            if (oper0->hasName() && oper1->hasName())
+                                            // Loop condition not reached yet, tripcount unknown
+                                            if (!hasCmpReference(brInst->getCondition(), mapCmp, engine))
                                             {
-                                                errs() << "\n\nUNEXPECTED DOUBLE REFERENCE CMP INSTRUCTION\n\n";
+                                                continue;
                                             }
-                                            // a < 1
-                                            else if (oper0->hasName())
-                                            {
-                                                // Select reference to operand0
-                                                oper = oper0;
 
-                                                if (ConstantInt *CI = dyn_cast<ConstantInt>(oper1))
-                                                {
-                                                    // Change range of successors based on reference, constant value, and predicate
-                                                    computeCmpRange(true, pred, oper, CI->getZExtValue(), &rangeCmpTaken, &rangeCmpNotTaken);
-                                                }
-                                            }
-                                            // 1 < a
-                                            else
+                                            // VAL1: Range of the cmp instruction for branch taken
+                                            Range rangeCmpTaken;
+                                            Range rangeCmpNotTaken;
+                                            Value *oper = getBranchRanges(mapCmp->find(brInst->getCondition())->second, &rangeCmpTaken, &rangeCmpNotTaken);
+                                            if (oper == nullptr)
                                             {
-                                                // Select reference to operand0
-                                                oper = oper1;
-
-                                                if (ConstantInt *CI = dyn_cast<ConstantInt>(oper0))
-                                                {
-                                                    // Change range of successors based on reference, constant value, and predicate
-                                                    computeCmpRange(false, pred, oper, CI->getZExtValue(), &rangeCmpTaken, &rangeCmpNotTaken);
-                                                }
+                                                continue;
                                             }
 
                                             // VAL3: Range in current basic block of the variable in the cmp instruction
-                                            std::map<Value *, std::pair<int, int>>::iterator valRefSource = getValueReference(BB, oper, listRange, infMin, infMax);
+                                            Range valRefSource = getValueReference(BB, oper, listRange, engine, state);
                                             // VAL4: Range in taken basic block of the variable in the cmp instruction
-                                            std::map<Value *, std::pair<int, int>>::iterator valBranchTaken = getValueReference(succ0, oper, listRange, infMin, infMax);
+                                            Range valBranchTaken = getValueReference(succ0, oper, listRange, engine, state);
 
                                             // Final computed branch ranges
-                                            std::pair<int, int> rangeBranchTaken = brOpe(valRefSource->second, valBranchTaken->second, rangeCmpTaken);
-                                            if (oper != inst && rangeBranchTaken.first != infMin && rangeBranchTaken.second != infMax)
+                                            Range rangeBranchTaken = interOpe(valBranchTaken, brOpe(valRefSource, rangeCmpTaken));
+                                            if (!isEmptyRange(rangeBranchTaken) && !rangeBranchTaken.first.isMinSignedValue() && !rangeBranchTaken.second.isMaxSignedValue())
                                             {
-                                                tripcount = std::abs(rangeBranchTaken.second - rangeBranchTaken.first) + 1;
+                                                unsigned tripWidth = 2 * std::max(baseVal.getBitWidth(), rangeBranchTaken.first.getBitWidth()) + 2;
+                                                APInt loopTripcount = rangeBranchTaken.second.sext(tripWidth) - rangeBranchTaken.first.sext(tripWidth) + 1;
+                                                if (oper != inst)
+                                                {
+                                                    tripcount = loopTripcount;
+                                                }
+                                                else
+                                                {
+                                                    // Compared value is the phi: monotone (nsw step), one value of the range for each iteration
+                                                    // Narrowing only shrinks the ranges: the last tripcount is the smallest
+                                                    uint64_t &stateTripcount = state->tripcounts[succ];
+                                                    stateTripcount = stateTripcount == 0 ? loopTripcount.getLimitedValue() : std::min(stateTripcount, loopTripcount.getLimitedValue());
+                                                }
                                             }
                                         }
                                     }
                                 }
 
                                 // Search add/sub instruction
-                                if (tripcount != -1)
+                                if (tripcount.getBoolValue())
                                 {
-                                    errs() << "Tripcount " << tripcount << "\n";
+                                    TRACE(1, errs() << "Tripcount " << tripcount << "\n");
                                     for (BasicBlock::InstListType::iterator subIt =
                                              BB->getInstList().begin();
                                          subIt != BB->getInstList().end(); ++subIt)
                                     {
                                         Instruction *subI = &*subIt;
-                                        if (auto *operInst = dyn_cast<BinaryOperator>(subI))
+                                        APInt step;
+                                        // Add/Sub in which the result is the operand in the phi instruction
+                                        if (subI != operand || !getStep(dyn_cast<BinaryOperator>(subI), inst, &step))
                                         {
-                                            // Add/Sub in which the result is the operand in the phi instruction
-                                            if (operInst->getName() == operand->getName())
-                                            {
-                                                Value *oper0 = operInst->getOperand(0);
-                                                Value *oper1 = operInst->getOperand(1);
-                                                unsigned operCode = operInst->getOpcode();
+                                            continue;
+                                        }
 
-                                                if (oper0->getName() == inst->getName())
-                                                {
-                                                    if (ConstantInt *CI = dyn_cast<ConstantInt>(oper1))
-                                                    {
-                                                        int constVal = CI->getZExtValue();
-                                                        // a = a + 1 || a - (-1) -> Always growing
-                                                        if ((operCode == Instruction::Add && constVal >= 0) || (operCode == Instruction::Sub && constVal <= 0))
-                                                        {
-                                                            errs() << "Sum " << baseVal << " on " << constVal << " for " << tripcount << "\n";
-                                                            errs() << "=" << ((constVal * tripcount) + baseVal) << "\n";
-                                                            tripPair->first = baseVal;
-                                                            tripPair->second = ((constVal * tripcount) + baseVal);
-                                                        }
-                                                        // a = a + (-1) || a - 1 -> Always smaller
-                                                        else if ((operCode == Instruction::Add && constVal <= 0) || (operCode == Instruction::Sub && constVal >= 0))
-                                                        {
-                                                            errs() << "Sum " << baseVal << " on " << constVal << " for " << tripcount << "\n";
-                                                            errs() << "=" << ((-constVal * tripcount) + baseVal) << "\n";
-                                                            tripPair->first = ((-constVal * tripcount) + baseVal);
-                                                            tripPair->second = baseVal;
-                                                        }
-                                                    }
-                                                }
-                                                else if (oper1->getName() == inst->getName())
-                                                {
-                                                    if (ConstantInt *CI = dyn_cast<ConstantInt>(oper0))
-                                                    {
-                                                        int constVal = CI->getZExtValue();
-                                                        // a = a + 1 || a - (-1) -> Always growing
-                                                        if ((operCode == Instruction::Add && constVal >= 0) || (operCode == Instruction::Sub && constVal <= 0))
-                                                        {
-                                                            errs() << "Sum " << baseVal << " on " << constVal << " for " << tripcount << "\n";
-                                                            errs() << "=" << ((constVal * tripcount) + baseVal) << "\n";
-                                                            tripPair->first = baseVal;
-                                                            tripPair->second = ((constVal * tripcount) + baseVal);
-                                                        }
-                                                        // a = a + (-1) || a - 1 -> Always smaller
-                                                        else if ((operCode == Instruction::Add && constVal <= 0) || (operCode == Instruction::Sub && constVal >= 0))
-                                                        {
-                                                            errs() << "Sum " << baseVal << " on " << constVal << " for " << tripcount << "\n";
-                                                            errs() << "=" << ((-constVal * tripcount) + baseVal) << "\n";
-                                                            tripPair->first = ((-constVal * tripcount) + baseVal);
-                                                            tripPair->second = baseVal;
-                                                        }
-                                                    }
-                                                }
-                                            }
+                                        // a = a + 1 || a - (-1) -> Always growing, a = a + (-1) || a - 1 -> Always smaller
+                                        unsigned width = baseVal.getBitWidth();
+                                        APInt bound = baseVal.sext(tripcount.getBitWidth()) + step.sext(tripcount.getBitWidth()) * tripcount;
+                                        TRACE(2, errs() << "Sum " << baseVal << " on " << step << " for " << tripcount << "\n");
+                                        TRACE(2, errs() << "=" << bound << "\n");
+                                        if (bound.getMinSignedBits() > width)
+                                        {
+                                            continue;
+                                        }
+
+                                        if (step.isNonNegative())
+                                        {
+                                            tripPair->first = baseVal;
+                                            tripPair->second = bound.trunc(width);
+                                        }
+                                        else
+                                        {
+                                            tripPair->first = bound.trunc(width);
+                                            tripPair->second = baseVal;
                                         }
                                     }
                                 }
@@ -697,6 +1810,7 @@ namespace
 
         // 1: The value is found and always grows higher
         // 2: The value is found and always grows smaller
+        // The step must not wrap (nsw): a growing value could wrap around to the minimum otherwise
         int searchInBasicBlock(Value *inst, BasicBlock *BB, Value *operand)
         {
             bool isSum = false, isSub = false, isFound = false;
@@ -706,346 +1820,1200 @@ namespace
                  subIt != BB->getInstList().end(); ++subIt)
             {
                 Instruction *subI = &*subIt;
-                if (auto *operInst = dyn_cast<BinaryOperator>(subI))
+                APInt step;
+                if (subI != operand || !getStep(dyn_cast<BinaryOperator>(subI), inst, &step) || !subI->hasNoSignedWrap())
+                {
+                    continue;
+                }
+
+                // a = a + 1 || a - (-1) -> Always growing
+                if (step.isNonNegative())
+                {
+                    isSum = true;
+                    isFound = true;
+                }
+                // a = a + (-1) || a - 1 -> Always smaller
+                else
+                {
+                    isSub = true;
+                    isFound = true;
+                }
+            }
+
+            // Found, but only sum xor sub
+            if (isFound && isSum && !isSub)
+            {
+                return 1;
+            }
+            else if (isFound && !isSum && isSub)
+            {
+                return 2;
+            }
+
+            return 0;
+        }
+
+        // Step of inst in a = a + c, a = c + a, a = a - c (signed, one bit wider than the value to hold -c)
+        bool getStep(BinaryOperator *operInst, Value *inst, APInt *step)
+        {
+            if (operInst == nullptr || (operInst->getOpcode() != Instruction::Add && operInst->getOpcode() != Instruction::Sub))
+            {
+                return false;
+            }
+
+            ConstantInt *CI = nullptr;
+            if (operInst->getOperand(0) == inst)
+            {
+                CI = dyn_cast<ConstantInt>(operInst->getOperand(1));
+            }
+            else if (operInst->getOperand(1) == inst && operInst->getOpcode() == Instruction::Add)
+            {
+                CI = dyn_cast<ConstantInt>(operInst->getOperand(0));
+            }
+            if (CI == nullptr)
+            {
+                return false;
+            }
+
+            *step = CI->getValue().sext(CI->getBitWidth() + 1);
+            if (operInst->getOpcode() == Instruction::Sub)
+            {
+                step->negate();
+            }
+            return true;
+        }
+
+        // If basic block not already visited and not already inside workList, insert it in workList
+        // Later visits are scheduled by the engine when a range read in the block changes
+        template <typename RangeTable>
+        void applySimpleBr(BasicBlock *from, BasicBlock *BB, RangeTable *listRange, FixpointEngine *workList, FixpointState *state)
+        {
+            bool isVisited = isAlreadyVisited(BB, listRange);
+            if (!isVisited)
+            {
+                listRange->markVisited(BB);
+            }
+
+            // New executable edge, the incoming ranges of BB change (see isExecutableEdge)
+            if (state->executableEdges.insert(std::make_pair(from, BB)).second)
+            {
+                workList->update(BB, from);
+            }
+
+            bool isInWL = isInWorkList(BB, workList);
+            if (!isVisited && !isInWL)
+            {
+                TRACE(1, errs() << "+ " << BB->getName() << "\n");
+                workList->pushBlock(BB);
+            }
+        }
+
+        // Lattice operations of IntervalLattice (BranchRangeLattice.h)
+        // Min of minimum values, max of maximum values (an empty range is ignored)
+        Range unionOpe(const Range &range0, const Range &range1)
+        {
+            return IntervalLattice::join(range0, range1);
+        }
+
+        // Max of minimum values, min of maximum values
+        Range interOpe(const Range &range0, const Range &range1)
+        {
+            return IntervalLattice::meet(range0, range1);
+        }
+
+        // Range combining operation for phi instructions (incoming ranges)
+        // Combined with the previous range by updateValueReference
+        Range phiOpe(const Range &rangeSource0, const Range &rangeSource1)
+        {
+            return IntervalLattice::phi(rangeSource0, rangeSource1);
+        }
+
+        // Range combining operation for br-complex instructions (edge of the branch)
+        Range brOpe(const Range &rangeSource, const Range &rangeBranch)
+        {
+            return IntervalLattice::branch(rangeSource, rangeBranch);
+        }
+
+        // Widening: a bound still growing jumps to the next threshold, -Inf/+Inf after the last one
+        Range widenOpe(const Range &rangeOld, const Range &rangeNew, const std::vector<APInt> &thresholds)
+        {
+            return IntervalLattice::widen(rangeOld, rangeNew, thresholds);
+        }
+
+        // Empty range (min > max): no execution reaches the value
+        bool isEmptyRange(const Range &range)
+        {
+            return IntervalLattice::isEmpty(range);
+        }
+
+        // Compute binary operation result in the bit width of the operation, wrapping like the instruction:
+        // with nsw/nuw the result only holds the values computed without overflow
+        // Add/Sub: a -Inf (+Inf) bound of an operand stays -Inf (+Inf), an unknown value is not shifted
+        // Add/Sub without nuw of i1/i8/i16/i32/i64 on the fixed-width kernels, ConstantRange otherwise
+        Range binaryOperationResult(BinaryOperator *operInst, const Range &range0, const Range &range1)
+        {
+            unsigned noWrapKind = 0;
+            if (isa<OverflowingBinaryOperator>(operInst))
+            {
+                noWrapKind |= operInst->hasNoSignedWrap() ? OverflowingBinaryOperator::NoSignedWrap : 0;
+                noWrapKind |= operInst->hasNoUnsignedWrap() ? OverflowingBinaryOperator::NoUnsignedWrap : 0;
+            }
+            return IntervalLattice::binaryOp(operInst->getOpcode(), range0, range1, noWrapKind);
+        }
+
+        // Computes ranges from CMP instruction (<, >, <=, >=, ==, !=, signed and unsigned)
+        // Exact region of the predicate for the branch taken, its complement for the branch not taken
+        // (signed hull: a <u 10 not taken is (-Inf, +Inf), negative values are >= 10 unsigned)
+        void computeCmpRange(bool isRefOper0, ICmpInst::Predicate pred, Value *oper, const APInt &cmpValue, Range *rangeSuccessor0, Range *rangeSuccessor1)
+        {
+            // 1 < a is a > 1
+            if (!isRefOper0)
+            {
+                pred = ICmpInst::getSwappedPredicate(pred);
+            }
+            // Only read by the trace (compiled out with NDEBUG)
+            (void)oper;
+            TRACE(2, errs() << oper->getName() << " " << ICmpInst::getPredicateName(pred) << " " << cmpValue << "\n");
+
+            IntervalLattice::compareRegions(pred, cmpValue, rangeSuccessor0, rangeSuccessor1);
+        }
+
+        // Ranges of the cmp reference for branch taken and not taken
+        // Returns the reference (nullptr when the cmp compares two references or no integers)
+        Value *getBranchRanges(CmpInst *cmpInst, Range *rangeCmpTaken, Range *rangeCmpNotTaken)
+        {
+            ICmpInst::Predicate pred = cmpInst->getPredicate();
+            Value *oper0 = cmpInst->getOperand(0);
+            Value *oper1 = cmpInst->getOperand(1);
+
+            // Pointers and floating point values (fcmp) have no range
+            if (!oper0->getType()->isIntegerTy())
+            {
+                return nullptr;
+            }
+            *rangeCmpTaken = BranchRangeInfo::getFullRange(oper0->getType()->getIntegerBitWidth());
+            *rangeCmpNotTaken = *rangeCmpTaken;
+
+            // a < b
+            if (oper0->hasName() && oper1->hasName())
+            {
+                TRACE(2, errs() << "\n\nUNEXPECTED DOUBLE REFERENCE CMP INSTRUCTION\n\n");
+                return nullptr;
+            }
+            // a < 1
+            else if (oper0->hasName())
+            {
+                if (ConstantInt *CI = dyn_cast<ConstantInt>(oper1))
+                {
+                    // Change range of successors based on reference, constant value, and predicate
+                    computeCmpRange(true, pred, oper0, CI->getValue(), rangeCmpTaken, rangeCmpNotTaken);
+                }
+                return oper0;
+            }
+
+            // 1 < a
+            if (ConstantInt *CI = dyn_cast<ConstantInt>(oper0))
+            {
+                // Change range of successors based on reference, constant value, and predicate
+                computeCmpRange(false, pred, oper1, CI->getValue(), rangeCmpTaken, rangeCmpNotTaken);
+            }
+            return oper1;
+        }
+
+        // Loop headers (targets of back-edges) and thresholds of the widening
+        // Thresholds are the bounds computeCmpRange can produce (cmp constant, +1 and -1), for each bit width
+        void collectWideningPoints(Function &Func, FixpointState *state)
+        {
+            SmallVector<std::pair<const BasicBlock *, const BasicBlock *>, 8> backEdges;
+            FindFunctionBackedges(Func, backEdges);
+            for (std::pair<const BasicBlock *, const BasicBlock *> &backEdge : backEdges)
+            {
+                state->loopHeaders.insert(backEdge.second);
+            }
+
+            for (BasicBlock &BB : Func)
+            {
+                for (Instruction &I : BB)
                 {
-                    if (operInst->getName() == operand->getName())
+                    if (!isa<CmpInst>(I))
                     {
-                        Value *oper0 = operInst->getOperand(0);
-                        Value *oper1 = operInst->getOperand(1);
-                        unsigned operCode = operInst->getOpcode();
+                        continue;
+                    }
 
-                        if (oper0->getName() == inst->getName())
+                    for (Value *operand : I.operands())
+                    {
+                        if (ConstantInt *CI = dyn_cast<ConstantInt>(operand))
                         {
-                            if (ConstantInt *CI = dyn_cast<ConstantInt>(oper1))
+                            const APInt &cmpValue = CI->getValue();
+                            std::vector<APInt> &thresholds = state->thresholds[CI->getBitWidth()];
+                            thresholds.push_back(cmpValue);
+                            if (!cmpValue.isMinSignedValue())
                             {
-                                int constVal = CI->getZExtValue();
-                                // a = a + 1 || a - (-1) -> Always growing
-                                if ((operCode == Instruction::Add && constVal >= 0) || (operCode == Instruction::Sub && constVal <= 0))
-                                {
-                                    isSum = true;
-                                    isFound = true;
-                                }
-                                // a = a + (-1) || a - 1 -> Always smaller
-                                else if ((operCode == Instruction::Add && constVal <= 0) || (operCode == Instruction::Sub && constVal >= 0))
-                                {
-                                    isSub = true;
-                                    isFound = true;
-                                }
+                                thresholds.push_back(cmpValue - 1);
                             }
-                        }
-                        else if (oper1->getName() == inst->getName())
-                        {
-                            if (ConstantInt *CI = dyn_cast<ConstantInt>(oper0))
+                            if (!cmpValue.isMaxSignedValue())
                             {
-                                int constVal = CI->getZExtValue();
-                                // a = a + 1 || a - (-1) -> Always growing
-                                if ((operCode == Instruction::Add && constVal >= 0) || (operCode == Instruction::Sub && constVal <= 0))
-                                {
-                                    isSum = true;
-                                    isFound = true;
-                                }
-                                // a = a + (-1) || a - 1 -> Always smaller
-                                else if ((operCode == Instruction::Add && constVal <= 0) || (operCode == Instruction::Sub && constVal >= 0))
-                                {
-                                    isSub = true;
-                                    isFound = true;
-                                }
+                                thresholds.push_back(cmpValue + 1);
                             }
                         }
                     }
                 }
             }
 
-            // Found, but only sum xor sub
-            if (isFound && isSum && !isSub)
+            for (auto &widthThresholds : state->thresholds)
+            {
+                // -Inf and +Inf are not thresholds (reached after the last one)
+                std::vector<APInt> &thresholds = widthThresholds.second;
+                thresholds.erase(std::remove_if(thresholds.begin(), thresholds.end(), [](const APInt &threshold) {
+                                     return threshold.isMinSignedValue() || threshold.isMaxSignedValue();
+                                 }),
+                                 thresholds.end());
+                std::sort(thresholds.begin(), thresholds.end(), [](const APInt &lhs, const APInt &rhs) { return lhs.slt(rhs); });
+                thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+            }
+        }
+
+        // Check if given BasicBlock is already visited in listRange
+        template <typename RangeTable>
+        bool isAlreadyVisited(BasicBlock *next, RangeTable *listRange)
+        {
+            return listRange->isVisited(next);
+        }
+
+        // Update or insert new Value/Pair into basic block
+        // Ascending phase: join with the previous range (widening in loop headers)
+        // Narrowing phase: meet with the previous range (see FixpointState)
+        template <typename RangeTable>
+        void updateValueReference(BasicBlock *BB, Value *operand, Range pairRange, RangeTable *listRange, FixpointEngine *engine, FixpointState *state)
+        {
+            // Not reached yet, nothing to insert
+            if (isEmptyRange(pairRange))
+            {
+                return;
+            }
+
+            if (hasValueReference(BB, operand, listRange))
+            {
+                Range oldRange = listRange->getRange(BB, operand);
+                bool isLoopHeader = state->loopHeaders.count(BB);
+                if (!state->isNarrowing)
+                {
+                    pairRange = unionOpe(oldRange, pairRange);
+                    if (isLoopHeader)
+                    {
+                        Range joinRange = pairRange;
+                        pairRange = widenOpe(oldRange, pairRange, state->thresholds[pairRange.first.getBitWidth()]);
+                        engine->counters.widenings += pairRange != joinRange;
+                    }
+                }
+                else
+                {
+                    pairRange = interOpe(oldRange, pairRange);
+                    // Empty meet or no narrowing steps left, keep the previous range
+                    if (isEmptyRange(pairRange) || (pairRange != oldRange && isLoopHeader && ++state->narrowings[std::make_pair(BB, operand)] > NarrowingLimit))
+                    {
+                        pairRange = oldRange;
+                    }
+                }
+
+                if (oldRange != pairRange)
+                {
+                    engine->update(BB, operand);
+                    engine->counters.valuesToTop += pairRange.first.isMinSignedValue() && pairRange.second.isMaxSignedValue();
+                }
+                TRACE(1, errs() << "UPDATE: ");
+            }
+            else
+            {
+                // Insert reference
+                engine->update(BB, operand);
+                TRACE(1, errs() << "NEW: ");
+            }
+            listRange->setRange(BB, operand, pairRange);
+
+            // Update reference
+            TRACE(1, errs() << operand->getName() << printRange(pairRange) << " in " << BB->getName() << "\n");
+        }
+
+        // Check if given BasicBlock is already visited in listRange
+        template <typename RangeTable>
+        bool hasValueReference(BasicBlock *next, Value *operand, RangeTable *listRange)
+        {
+            // No reference if never visited
+            return listRange->hasRange(next, operand);
+        }
+
+        // Get range of value from listRange
+        // Without a range in BB, the range in the closest dominator holds (up to the definition)
+        // Every range looked up is recorded as read by the instruction currently evaluated
+        template <typename RangeTable>
+        Range getValueReference(BasicBlock *BB, Value *operand, RangeTable *listRange, FixpointEngine *engine, FixpointState *state)
+        {
+            DomTreeNode *domNode = state->domTree->getNode(BB);
+            while (true)
+            {
+                engine->read(BB, operand);
+                if (hasValueReference(BB, operand, listRange))
+                {
+                    return listRange->getRange(BB, operand);
+                }
+
+                if (isDefinedIn(operand, BB) || domNode == nullptr || domNode->getIDom() == nullptr)
+                {
+                    break;
+                }
+                domNode = domNode->getIDom();
+                BB = domNode->getBlock();
+            }
+
+            // Unknown variables from -Inf to +Inf
+            return BranchRangeInfo::getFullRange(operand->getType()->getIntegerBitWidth());
+        }
+
+        Range getConstantPair(Value *operand)
+        {
+            if (ConstantInt *CI = dyn_cast<ConstantInt>(operand))
+            {
+                return Range(CI->getValue(), CI->getValue());
+            }
+
+            // Unknown variables from -Inf to +Inf
+            TRACE(2, errs() << "\n\nEXPECTED CONSTANT IS NOT ACTUALLY CONSTANT!\n\n");
+            return BranchRangeInfo::getFullRange(operand->getType()->getIntegerBitWidth());
+        }
+
+        // Range of an operand of an instruction in BB: constant, reference, or unknown (unnamed value)
+        template <typename RangeTable>
+        Range getOperandRange(BasicBlock *BB, Value *operand, RangeTable *listRange, FixpointEngine *engine, FixpointState *state)
+        {
+            if (ConstantInt *CI = dyn_cast<ConstantInt>(operand))
+            {
+                return Range(CI->getValue(), CI->getValue());
+            }
+            if (!operand->hasName())
+            {
+                return BranchRangeInfo::getFullRange(operand->getType()->getIntegerBitWidth());
+            }
+            return getValueReference(BB, operand, listRange, engine, state);
+        }
+
+        // Check if given BasicBlock is already inside the workList
+        bool isInWorkList(BasicBlock *next, FixpointEngine *workList)
+        {
+            return workList->containsBlock(next);
+        }
+
+        // Check if the CFG edge from -> to has been taken (recorded as read by the current instruction)
+        bool isExecutableEdge(BasicBlock *from, BasicBlock *to, FixpointEngine *engine, FixpointState *state)
+        {
+            engine->read(to, from);
+            return state->executableEdges.count(std::make_pair(from, to));
+        }
+
+        // Check if the value is an instruction of the given basic block
+        bool isDefinedIn(Value *operand, BasicBlock *BB)
+        {
+            Instruction *operInst = dyn_cast<Instruction>(operand);
+            return operInst != nullptr && operInst->getParent() == BB;
+        }
+
+        // Range of operand along the edge from -> to (empty when the edge is not executable)
+        // Refined by the cmp when the br-complex of from compares operand
+        template <typename RangeTable>
+        Range getEdgeRange(BasicBlock *from, BasicBlock *to, Value *operand, RangeTable *listRange, std::map<Value *, CmpInst *> *mapCmp, FixpointEngine *engine, FixpointState *state)
+        {
+            if (!isExecutableEdge(from, to, engine, state))
+            {
+                return BranchRangeInfo::getEmptyRange(operand->getType()->getIntegerBitWidth());
+            }
+
+            Range valRefSource = getValueReference(from, operand, listRange, engine, state);
+            BranchInst *brInst = dyn_cast<BranchInst>(from->getTerminator());
+            if (brInst == nullptr || brInst->isUnconditional() || !hasCmpReference(brInst->getCondition(), mapCmp, engine))
+            {
+                return valRefSource;
+            }
+
+            Range rangeCmpTaken;
+            Range rangeCmpNotTaken;
+            if (getBranchRanges(mapCmp->find(brInst->getCondition())->second, &rangeCmpTaken, &rangeCmpNotTaken) != operand)
+            {
+                return valRefSource;
+            }
+
+            // Both successors can be the same basic block
+            Range rangeEdge = BranchRangeInfo::getEmptyRange(operand->getType()->getIntegerBitWidth());
+            if (brInst->getSuccessor(0) == to)
+            {
+                rangeEdge = unionOpe(rangeEdge, brOpe(valRefSource, rangeCmpTaken));
+            }
+            if (brInst->getSuccessor(1) == to)
+            {
+                rangeEdge = unionOpe(rangeEdge, brOpe(valRefSource, rangeCmpNotTaken));
+            }
+
+            return rangeEdge;
+        }
+
+        // Range of operand entering BB, join of the ranges along every incoming edge
+        template <typename RangeTable>
+        Range getIncomingRange(BasicBlock *BB, Value *operand, RangeTable *listRange, std::map<Value *, CmpInst *> *mapCmp, FixpointEngine *engine, FixpointState *state)
+        {
+            Range rangeIncoming = BranchRangeInfo::getEmptyRange(operand->getType()->getIntegerBitWidth());
+            for (BasicBlock *Pred : predecessors(BB))
             {
-                return 1;
+                rangeIncoming = unionOpe(rangeIncoming, getEdgeRange(Pred, BB, operand, listRange, mapCmp, engine, state));
             }
-            else if (isFound && !isSum && isSub)
+
+            return rangeIncoming;
+        }
+
+        // Check if the cmp instruction of a br condition has been found (recorded as read)
+        bool hasCmpReference(Value *condition, std::map<Value *, CmpInst *> *mapCmp, FixpointEngine *engine)
+        {
+            if (Instruction *condInst = dyn_cast<Instruction>(condition))
             {
-                return 2;
+                engine->read(condInst->getParent(), condInst);
             }
 
-            return 0;
+            return mapCmp->find(condition) != mapCmp->end();
         }
 
-        // If basic block not already visited and not already inside workList, insert it in workList
-        void applySimpleBr(bool isUpdated, BasicBlock *BB, std::map<BasicBlock *, std::map<Value *, std::pair<int, int>>> *listRange, std::vector<BasicBlock *> *workList, std::map<Value *, std::pair<int, int>> emptyMap)
+        // Predecessors and ranges of a basic block (trace of the dense engine)
+        template <typename RangeTable>
+        void printBlockRanges(BasicBlock *BB, RangeTable *listRange)
         {
-            bool isVisited = isAlreadyVisited(BB, listRange);
-            if (!isVisited)
+            for (BasicBlock *Pred : predecessors(BB))
             {
-                listRange->insert(std::pair<BasicBlock *, std::map<Value *, std::pair<int, int>>>(BB, emptyMap));
+                errs() << "..." << Pred->getName() << "\n";
             }
 
-            bool isInWL = isInWorkList(BB, workList);
-            if ((!isVisited || isUpdated) && !isInWL)
+            bool hasReferences = false;
+            listRange->forEachRange(BB, [&](Value *ref, Range range) {
+                hasReferences = true;
+                errs() << "___" << ref->getName() << printRange(range) << "\n";
+            });
+            if (!hasReferences)
             {
-                errs() << "+ " << BB->getName() << " (notVisited=" << !isVisited << ", isUpdated=" << isUpdated << ")\n";
-                workList->push_back(BB);
+                errs() << "___No references\n";
             }
+            errs() << "\n";
         }
+    };
 
-        // Min of minimum values, max of maximum values
-        std::pair<int, int> unionOpe(std::pair<int, int> range0, std::pair<int, int> range1)
+    // Module driver: every function analyzed on a thread pool, largest functions first
+    // Each function has its own result slot (module order), no lock needed
+    // The trace (-debug-only) of concurrent functions is interleaved, use -branch-range-threads=1
+    void computeModuleRanges(Module &M, std::vector<BranchRangeInfo> *results)
+    {
+        std::vector<Function *> functions;
+        std::vector<unsigned> instCount;
+        for (Function &Func : M)
         {
-            return std::pair<int, int>(std::min(range0.first, range1.first), std::max(range0.second, range1.second));
+            if (!Func.isDeclaration())
+            {
+                functions.push_back(&Func);
+                instCount.push_back(Func.getInstructionCount());
+            }
         }
+        results->clear();
+        results->resize(functions.size());
 
-        // Max of minimum values, min of maximum values
-        std::pair<int, int> interOpe(std::pair<int, int> range0, std::pair<int, int> range1)
+        // Largest first: the last tasks of the pool are the shortest ones
+        std::vector<unsigned> order(functions.size());
+        for (unsigned funcIdx = 0; funcIdx < order.size(); ++funcIdx)
         {
-            return std::pair<int, int>(std::max(range0.first, range1.first), std::min(range0.second, range1.second));
+            order[funcIdx] = funcIdx;
         }
+        std::stable_sort(order.begin(), order.end(), [&](unsigned lhs, unsigned rhs) {
+            return instCount[lhs] > instCount[rhs];
+        });
 
-        // Range combining operation for phi instructions
-        std::pair<int, int> phiOpe(std::pair<int, int> rangeOriginal, std::pair<int, int> rangeSource0, std::pair<int, int> rangeSource1)
+        ThreadPool pool(hardware_concurrency(ThreadCount));
+        bool isTimed = isTimingEnabled() && pool.getThreadCount() == 1;
+        for (unsigned funcIdx : order)
         {
-            return interOpe(rangeOriginal, unionOpe(rangeSource0, rangeSource1));
+            pool.async([funcIdx, &functions, results, isTimed] {
+                Function &Func = *functions[funcIdx];
+                DominatorTree domTree(Func);
+                BranchRangeSolver solver;
+                solver.isTimed = isTimed;
+                solver.run(Func, &domTree, &(*results)[funcIdx]);
+            });
         }
+        pool.wait();
+    }
+
+    struct HppsBranchRange : public FunctionPass
+    {
+        static char ID;
+        HppsBranchRange() : FunctionPass(ID) {}
 
-        // Range combining operation for br-complex instructions
-        std::pair<int, int> brOpe(std::pair<int, int> rangeSource, std::pair<int, int> rangeDestination, std::pair<int, int> rangeBranch)
+        // Run over a single function
+        bool runOnFunction(Function &Func) override
         {
-            return interOpe(rangeBranch, interOpe(rangeSource, rangeDestination));
+            BranchRangeInfo info;
+            BranchRangeSolver().run(Func, &getAnalysis<DominatorTreeWrapperPass>().getDomTree(), &info);
+            info.print(errs());
+
+            return false;
         }
 
-        // Compute binary operation (+ or -) result
-        int binaryOperationResult(unsigned binOper, int value1, int value2)
+        void getAnalysisUsage(AnalysisUsage &AU) const override
         {
-            if (binOper == Instruction::Add)
-            {
-                return value1 + value2;
-            }
-            else if (binOper == Instruction::Sub)
+            AU.addRequired<DominatorTreeWrapperPass>();
+            AU.setPreservesAll();
+        }
+    }; // namespace
+
+    // Same report as -branch-range, functions analyzed in parallel (see computeModuleRanges)
+    struct HppsBranchRangeModule : public ModulePass
+    {
+        static char ID;
+        HppsBranchRangeModule() : ModulePass(ID) {}
+
+        bool runOnModule(Module &M) override
+        {
+            std::vector<BranchRangeInfo> results;
+            computeModuleRanges(M, &results);
+            for (const BranchRangeInfo &info : results)
             {
-                return value1 - value2;
+                info.print(errs());
             }
 
-            return value1 + value2;
+            return false;
         }
 
-        // Computes ranges from CMP instruction (<, >, <=, >=)
-        void computeCmpRange(bool isRefOper0, ICmpInst::Predicate pred, Value *oper, int cmpValue, std::pair<int, int> *rangeSuccessor0, std::pair<int, int> *rangeSuccessor1)
+        void getAnalysisUsage(AnalysisUsage &AU) const override
         {
-            if (pred == ICmpInst::ICMP_SLT)
-            {
-                // a < 1
-                if (isRefOper0)
-                {
-                    errs() << oper->getName() << " < " << cmpValue << "\n";
-                    rangeSuccessor0->second = cmpValue - 1;
-                    rangeSuccessor1->first = cmpValue;
-                }
-                // 1 < a
-                else
-                {
-                    errs() << cmpValue << " < " << oper->getName() << "\n";
-                    rangeSuccessor0->first = cmpValue + 1;
-                    rangeSuccessor1->second = cmpValue;
-                }
-            }
-            else if (pred == ICmpInst::ICMP_ULT)
-            {
-                // a < 1 [unsigned]
-                if (isRefOper0)
-                {
-                    errs() << oper->getName() << " < " << cmpValue << " [unsigned]\n";
-                    rangeSuccessor0->first = 0;
-                    rangeSuccessor0->second = cmpValue - 1;
-                    rangeSuccessor1->first = cmpValue;
-                }
-                // 1 < a (a > 1) [unsigned]
-                else
-                {
-                    errs() << cmpValue << " < " << oper->getName() << " [unsigned]\n";
-                    rangeSuccessor0->first = cmpValue + 1;
-                    rangeSuccessor1->first = 0;
-                    rangeSuccessor1->second = cmpValue;
-                }
-            }
-            else if (pred == ICmpInst::ICMP_SLE)
-            {
-                // a <= 1
-                if (isRefOper0)
-                {
-                    errs() << oper->getName() << " <= " << cmpValue << "\n";
-                    rangeSuccessor0->second = cmpValue;
-                    rangeSuccessor1->first = cmpValue + 1;
-                }
-                // 1 <= a
-                else
-                {
-                    errs() << cmpValue << " <= " << oper->getName() << "\n";
-                    rangeSuccessor0->first = cmpValue;
-                    rangeSuccessor1->second = cmpValue - 1;
-                }
-            }
-            else if (pred == ICmpInst::ICMP_SGT)
-            {
-                // a > 1
-                if (isRefOper0)
-                {
-                    errs() << oper->getName() << " > " << cmpValue << "\n";
-                    rangeSuccessor0->first = cmpValue + 1;
-                    rangeSuccessor1->second = cmpValue;
-                }
-                // 1 > a
-                else
-                {
-                    errs() << cmpValue << " > " << oper->getName() << "\n";
-                    rangeSuccessor0->second = cmpValue - 1;
-                    rangeSuccessor1->first = cmpValue;
-                }
-            }
-            else if (pred == ICmpInst::ICMP_UGT)
-            {
-                // a > 1
-                if (isRefOper0)
-                {
-                    errs() << oper->getName() << " > " << cmpValue << "\n";
-                    rangeSuccessor0->first = cmpValue + 1;
-                    rangeSuccessor1->first = 0;
-                    rangeSuccessor1->second = cmpValue;
-                }
-                // 1 > a
-                else
-                {
-                    errs() << cmpValue << " > " << oper->getName() << "\n";
-                    rangeSuccessor0->first = cmpValue - 1;
-                    rangeSuccessor0->second = cmpValue - 1;
-                    rangeSuccessor1->first = cmpValue;
-                }
-            }
-            else if (pred == ICmpInst::ICMP_SGE)
-            {
-                // a >= 1
-                if (isRefOper0)
-                {
-                    errs() << oper->getName() << " >= " << cmpValue << "\n";
-                    rangeSuccessor0->first = cmpValue;
-                    rangeSuccessor1->second = cmpValue - 1;
-                }
-                // 1 >= a
-                else
-                {
-                    errs() << cmpValue << " >= " << oper->getName() << "\n";
-                    rangeSuccessor0->second = cmpValue;
-                    rangeSuccessor1->first = cmpValue + 1;
-                }
-            }
-            else if (pred == ICmpInst::ICMP_EQ)
-            {
-                // a == 1
-                errs() << oper->getName() << " == " << cmpValue << "\n";
-                rangeSuccessor0->first = cmpValue;
-                rangeSuccessor0->second = cmpValue;
-            }
+            AU.setPreservesAll();
         }
+    };
+} // end of anonymous namespace
 
-        // Check if given BasicBlock is already visited in listRange
-        bool isAlreadyVisited(BasicBlock *next, std::map<BasicBlock *, std::map<Value *, std::pair<int, int>>> *listRange)
+const BranchRangeInfo::BlockRanges &BranchRangeInfo::getBlockRanges(const BasicBlock *BB) const
+{
+    static const BlockRanges noRanges;
+    DenseMap<const BasicBlock *, unsigned>::const_iterator blockIt = blockIndex.find(BB);
+    return blockIt == blockIndex.end() ? noRanges : blockRanges[blockIt->second];
+}
+
+void BranchRangeInfo::addBlock(BasicBlock *BB)
+{
+    blockIndex[BB] = visitedBlocks.size();
+    visitedBlocks.push_back(BB);
+    blockRanges.emplace_back();
+}
+
+BranchRangeInfo::Range BranchRangeInfo::getRange(const BasicBlock *BB, const Value *V) const
+{
+    DenseMap<std::pair<const BasicBlock *, const Value *>, Range>::const_iterator rangeIt = ranges.find(std::make_pair(BB, V));
+    return rangeIt == ranges.end() ? getFullRange(V->getType()->getIntegerBitWidth()) : rangeIt->second;
+}
+
+BranchRangeInfo::Range BranchRangeInfo::getValueRange(const BasicBlock *BB, const Value *V) const
+{
+    if (auto *constInt = dyn_cast<ConstantInt>(V))
+    {
+        return Range(constInt->getValue(), constInt->getValue());
+    }
+    if (!hasRange(BB, V))
+    {
+        if (auto *I = dyn_cast<Instruction>(V))
         {
-            return listRange->find(next) != listRange->end();
+            return getRange(I->getParent(), I);
         }
+    }
+    return getRange(BB, V);
+}
 
-        // Update or insert new Value/Pair into basic block
-        void updateValueReference(BasicBlock *BB, Value *operand, std::pair<int, int> pairRange, std::map<BasicBlock *, std::map<Value *, std::pair<int, int>>> *listRange, int infMin, int infMax)
+void BranchRangeInfo::addEdge(BasicBlock *from, BasicBlock *to)
+{
+    executableEdges.insert(std::make_pair(from, to));
+}
+
+void BranchRangeInfo::addTripcount(BasicBlock *header, uint64_t tripcount)
+{
+    tripcounts[header] = tripcount;
+}
+
+void BranchRangeInfo::addRange(BasicBlock *BB, Value *V, const Range &R)
+{
+    blockRanges[blockIndex.find(BB)->second].push_back(std::make_pair(V, R));
+    ranges[std::make_pair(BB, V)] = R;
+}
+
+void BranchRangeInfo::update(Function &Func, DominatorTree &domTree, ArrayRef<BasicBlock *> changedBlocks)
+{
+    BranchRangeInfo info;
+    BranchRangeSolver().update(Func, &domTree, *this, changedBlocks, &info);
+    *this = std::move(info);
+}
+
+void BranchRangeInfo::update(Function &Func, DominatorTree &domTree, ArrayRef<Instruction *> changedInstructions)
+{
+    SmallVector<BasicBlock *, 8> changedBlocks;
+    for (Instruction *I : changedInstructions)
+    {
+        changedBlocks.push_back(I->getParent());
+    }
+    update(Func, domTree, changedBlocks);
+}
+
+void BranchRangeInfo::print(raw_ostream &OS) const
+{
+    PhaseRegion printRegion(PrintPhase, isTimingEnabled());
+
+    // --- PRINT FOUND RANGES FOR EACH BASIC BLOCK VISITED --- //
+    OS << "--- VALUE-RANGES ---\n";
+    for (unsigned blockIdx = 0; blockIdx < visitedBlocks.size(); ++blockIdx)
+    {
+        OS << "BB: " << visitedBlocks[blockIdx]->getName() << "\n";
+        for (const std::pair<Value *, Range> &valueRange : blockRanges[blockIdx])
         {
-            if (hasValueReference(BB, operand, listRange))
+            const Range &range = valueRange.second;
+            OS << "   " << valueRange.first->getName() << printRange(range) << " = ";
+
+            if (!range.first.isMinSignedValue() && !range.second.isMaxSignedValue())
             {
-                listRange->find(BB)->second.find(operand)->second.first = pairRange.first;
-                listRange->find(BB)->second.find(operand)->second.second = pairRange.second;
-                errs() << "UPDATE: ";
+                // Number of values, one bit wider than the value to hold 2^width
+                unsigned width = range.first.getBitWidth();
+                APInt intRange = range.second.sext(width + 1) - range.first.sext(width + 1) + 1;
+                unsigned numOfBit = (intRange.ule(2) ? 1 : intRange.ceilLogBase2()) + 1;
+                OS << toString(intRange, 10, /* Signed */ false) << " {" << numOfBit << "bit}\n";
             }
             else
             {
-                // Insert reference
-                std::pair<Value *, std::pair<int, int>> newPairRange(operand, pairRange);
-                listRange->find(BB)->second.insert(newPairRange);
-                errs() << "NEW: ";
+                OS << "MAX\n";
             }
+        }
+        OS << "\n";
+    }
 
-            // Update reference
-            errs() << operand->getName() << printRange(pairRange, infMin, infMax) << " in " << BB->getName() << "\n";
+    if (PrintCounters)
+    {
+        OS << "--- COUNTERS ---\n";
+        OS << "Worklist iterations: " << counters.iterations << "\n";
+        OS << "Block visits: " << counters.blockVisits << "\n";
+        OS << "Transfer evaluations: " << counters.evaluations << "\n";
+        OS << "Range updates: " << counters.updates << "\n";
+        OS << "Infeasible edges: " << countInfeasibleEdges() << "\n";
+        if (!CacheDir.empty())
+        {
+            OS << "Cache: " << (counters.cacheHits ? "hit" : "miss") << "\n";
         }
+        OS << "\n";
+    }
+}
 
-        // Check if given BasicBlock is already visited in listRange
-        bool hasValueReference(BasicBlock *next, Value *operand, std::map<BasicBlock *, std::map<Value *, std::pair<int, int>>> *listRange)
+unsigned BranchRangeInfo::countInfeasibleEdges() const
+{
+    unsigned infeasible = 0;
+    for (BasicBlock *BB : visitedBlocks)
+    {
+        for (BasicBlock *succ : successors(BB))
         {
-            // No reference if never visited
-            if (!isAlreadyVisited(next, listRange))
-            {
-                return false;
-            }
+            infeasible += !isExecutableEdge(BB, succ);
+        }
+    }
+    return infeasible;
+}
 
-            return listRange->find(next)->second.find(operand) != listRange->find(next)->second.end();
+// Stored ranges evaluated at the same time by a query, bounds its recursion (see getRangeAt)
+static const unsigned MaxQueryDepth = 1024;
+
+BranchRangeQuery::BranchRangeQuery(Function &Func, DominatorTree &domTree) : Func(Func), domTree(domTree)
+{
+    // Successors of the br-complex: basic blocks where the fixpoint stores the range of the compared value
+    for (BasicBlock &BB : Func)
+    {
+        Range rangeTaken;
+        Range rangeNotTaken;
+        Value *oper = getComparedValue(&BB, &rangeTaken, &rangeNotTaken);
+        if (oper == nullptr)
+        {
+            continue;
         }
 
-        // Get value and its range from listRange
-        std::map<Value *, std::pair<int, int>>::iterator getValueReference(BasicBlock *BB, Value *operand, std::map<BasicBlock *, std::map<Value *, std::pair<int, int>>> *listRange, int infMin, int infMax)
+        SmallVectorImpl<BasicBlock *> &blocks = refinedBlocks[oper];
+        for (BasicBlock *succ : successors(&BB))
         {
-            if (hasValueReference(BB, operand, listRange))
+            if (!isDefinedIn(oper, succ) && !is_contained(blocks, succ))
             {
-                return listRange->find(BB)->second.find(operand);
+                blocks.push_back(succ);
             }
-
-            // Unknown variables from -Inf to +Inf
-            std::pair<int, int> emptyIntPair(infMin, infMax);
-            std::map<Value *, std::pair<int, int>> emptyPair;
-            emptyPair[operand] = emptyIntPair;
-            return emptyPair.begin();
         }
+    }
+}
+
+BranchRangeQuery::Range BranchRangeQuery::getRangeAt(Value *V, BasicBlock *BB)
+{
+    ++counters.queries;
+    if (auto *constInt = dyn_cast<ConstantInt>(V))
+    {
+        return Range(constInt->getValue(), constInt->getValue());
+    }
 
-        std::pair<int, int> getConstantPair(Value *operand, int infMin, int infMax)
+    if (fixpoint == nullptr)
+    {
+        Range R = readRange(V, BB);
+
+        // Slice deeper than MaxQueryDepth: the stored range where it stopped is evaluated (and memoized)
+        // first, the deeper ones it stops on before it, then the query is retried
+        // The pending ranges stay in progress, a pending range reached again is a cycle
+        SmallVector<std::pair<BasicBlock *, Value *>, 4> deepQueries;
+        while (deepQuery.first != nullptr && !hasCycle)
         {
-            if (ConstantInt *CI = dyn_cast<ConstantInt>(operand))
+            deepQueries.push_back(deepQuery);
+            inProgress.insert(deepQuery);
+            while (!deepQueries.empty() && !hasCycle)
             {
-                int constValue = CI->getZExtValue();
-                return std::pair<int, int>(constValue, constValue);
+                std::pair<BasicBlock *, Value *> pending = deepQueries.back();
+                deepQuery = std::make_pair(nullptr, nullptr);
+                inProgress.erase(pending);
+                Range storedRange;
+                getStoredRange(pending.second, pending.first, &storedRange);
+                if (deepQuery.first != nullptr)
+                {
+                    inProgress.insert(pending);
+                    deepQueries.push_back(deepQuery);
+                    inProgress.insert(deepQuery);
+                    continue;
+                }
+                deepQueries.pop_back();
             }
 
-            // Unknown variables from -Inf to +Inf
-            errs() << "\n\nEXPECTED CONSTANT IS NOT ACTUALLY CONSTANT!\n\n";
-            return std::pair<int, int>(infMin, infMax);
+            if (!hasCycle)
+            {
+                R = readRange(V, BB);
+            }
+        }
+        if (!hasCycle)
+        {
+            return R;
         }
 
-        // Check if given BasicBlock is already inside the workList
-        bool isInWorkList(BasicBlock *next, std::vector<BasicBlock *> *workList)
+        // Slice with a cycle: the ranges of a loop need the widening and narrowing of the fixpoint
+        // (the memoized ranges are now read from the fixpoint)
+        hasCycle = false;
+        deepQuery = std::make_pair(nullptr, nullptr);
+        inProgress.clear();
+        memo.clear();
+        fixpoint.reset(new BranchRangeInfo());
+        BranchRangeSolver().run(Func, &domTree, fixpoint.get());
+    }
+    ++counters.fallbacks;
+    return readRange(V, BB);
+}
+
+// Range of V read in BB (getValueReference of the fixpoint): range stored in BB or in its closest
+// dominator, up to the definition of V. Only the definition and the refined blocks of V can store one
+BranchRangeQuery::Range BranchRangeQuery::readRange(Value *V, BasicBlock *BB)
+{
+    Range R = BranchRangeInfo::getFullRange(V->getType()->getIntegerBitWidth());
+    if (!domTree.isReachableFromEntry(BB))
+    {
+        return R;
+    }
+
+    // Blocks storing a range of V and dominating BB, closest first
+    SmallVector<BasicBlock *, 4> candidates;
+    DenseMap<const Value *, SmallVector<BasicBlock *, 2>>::const_iterator refinedIt = refinedBlocks.find(V);
+    if (refinedIt != refinedBlocks.end())
+    {
+        copy_if(refinedIt->second, std::back_inserter(candidates), [&](BasicBlock *refinedBB) { return domTree.dominates(refinedBB, BB); });
+    }
+    auto *I = dyn_cast<Instruction>(V);
+    if (I != nullptr && domTree.dominates(I->getParent(), BB))
+    {
+        candidates.push_back(I->getParent());
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](BasicBlock *lhs, BasicBlock *rhs) {
+        return domTree.getNode(lhs)->getLevel() > domTree.getNode(rhs)->getLevel();
+    });
+
+    for (BasicBlock *domBB : candidates)
+    {
+        Range storedRange;
+        if (getStoredRange(V, domBB, &storedRange))
+        {
+            return storedRange;
+        }
+        if (isAborted() || isDefinedIn(V, domBB))
+        {
+            break;
+        }
+    }
+    return R;
+}
+
+// Memoized range stored for V in BB, by the fixpoint once a query has fallen back to it
+// (false when none: no incoming edge taken, or a range depending on a query in progress)
+bool BranchRangeQuery::getStoredRange(Value *V, BasicBlock *BB, Range *R)
+{
+    if (fixpoint != nullptr)
+    {
+        if (!fixpoint->hasRange(BB, V))
+        {
+            return false;
+        }
+        *R = fixpoint->getRange(BB, V);
+        return true;
+    }
+
+    std::pair<const BasicBlock *, const Value *> key(BB, V);
+    DenseMap<std::pair<const BasicBlock *, const Value *>, Optional<Range>>::const_iterator memoIt = memo.find(key);
+    if (memoIt != memo.end())
+    {
+        ++counters.memoHits;
+        if (!memoIt->second.hasValue())
+        {
+            return false;
+        }
+        *R = memoIt->second.getValue();
+        return true;
+    }
+
+    // The range depends on itself: loop of the CFG (or of a phi)
+    if (!inProgress.insert(key).second)
+    {
+        hasCycle = true;
+        return false;
+    }
+    // Evaluated on its own (see getRangeAt), the stack holds MaxQueryDepth stored ranges in progress
+    if (depth == MaxQueryDepth)
+    {
+        inProgress.erase(key);
+        deepQuery = std::make_pair(BB, V);
+        return false;
+    }
+    ++depth;
+    bool isStored = computeStoredRange(V, BB, R);
+    --depth;
+    inProgress.erase(key);
+
+    // Ranges computed after a cycle or a slice too deep are not final (see getRangeAt)
+    if (!isAborted())
+    {
+        memo[key] = isStored ? Optional<Range>(*R) : None;
+    }
+    return isStored && !isAborted();
+}
+
+// Range of an operand of an instruction in BB: constant, reference, or unknown (unnamed value)
+BranchRangeQuery::Range BranchRangeQuery::getOperandRange(Value *V, BasicBlock *BB)
+{
+    if (ConstantInt *CI = dyn_cast<ConstantInt>(V))
+    {
+        return Range(CI->getValue(), CI->getValue());
+    }
+    if (!V->hasName())
+    {
+        return BranchRangeInfo::getFullRange(V->getType()->getIntegerBitWidth());
+    }
+    return readRange(V, BB);
+}
+
+// Range the fixpoint stores for V in BB: its definition, or the join of the incoming edges in a
+// refined block (false when no incoming edge is taken)
+bool BranchRangeQuery::computeStoredRange(Value *V, BasicBlock *BB, Range *R)
+{
+    if (isDefinedIn(V, BB))
+    {
+        return getDefinitionRange(cast<Instruction>(V), BB, R);
+    }
+
+    Range rangeIncoming = BranchRangeInfo::getEmptyRange(V->getType()->getIntegerBitWidth());
+    for (BasicBlock *Pred : predecessors(BB))
+    {
+        rangeIncoming = IntervalLattice::join(rangeIncoming, getEdgeRange(Pred, BB, V));
+        if (isAborted())
+        {
+            return false;
+        }
+    }
+    // No incoming edge taken: BB and the blocks it dominates are not reached (empty range)
+    // Without -branch-range-prune-edges the edges are taken, the fixpoint reads the dominator
+    *R = rangeIncoming;
+    return PruneEdges || !BranchRangeInfo::isEmptyRange(rangeIncoming);
+}
+
+// Transfer function of the instruction defining the value (binary operations and phis, like the
+// fixpoint). The bounds the fixpoint gives a loop phi from its increment and tripcount are not
+// needed: the increment reads the phi, its slice has a cycle
+bool BranchRangeQuery::getDefinitionRange(Instruction *I, BasicBlock *BB, Range *R)
+{
+    if (!I->getType()->isIntegerTy())
+    {
+        return false;
+    }
+
+    ++counters.evaluations;
+    if (auto *operInst = dyn_cast<BinaryOperator>(I))
+    {
+        Range range0 = getOperandRange(operInst->getOperand(0), BB);
+        Range range1 = getOperandRange(operInst->getOperand(1), BB);
+        // Empty operand: BB is not reached. Empty result of reached operands (division by zero): no range
+        if (BranchRangeInfo::isEmptyRange(range0) || BranchRangeInfo::isEmptyRange(range1))
         {
-            return std::find(workList->begin(), workList->end(), next) != workList->end();
+            *R = BranchRangeInfo::getEmptyRange(operInst->getType()->getIntegerBitWidth());
+            return !isAborted();
         }
+        *R = BranchRangeSolver().binaryOperationResult(operInst, range0, range1);
+        return !isAborted() && !BranchRangeInfo::isEmptyRange(*R);
+    }
 
-        std::string printRange(std::pair<int, int> rangeVal, int infMin, int infMax)
+    auto *phiInst = dyn_cast<PHINode>(I);
+    if (phiInst == nullptr || !phiInst->hasName())
+    {
+        return false;
+    }
+
+    // Join of the ranges along the taken incoming edges
+    *R = BranchRangeInfo::getEmptyRange(phiInst->getType()->getIntegerBitWidth());
+    for (unsigned inc = 0; inc < phiInst->getNumIncomingValues() && !isAborted(); ++inc)
+    {
+        Value *operand = phiInst->getIncomingValue(inc);
+        BasicBlock *incBB = phiInst->getIncomingBlock(inc);
+        if (!isFeasibleEdge(incBB, BB))
         {
-            std::string valString = "(";
+            continue;
+        }
 
-            if (rangeVal.first <= rangeVal.second)
+        Range valRef = operand->hasName() ? readRange(operand, incBB) : getOperandRange(operand, incBB);
+        *R = IntervalLattice::phi(*R, valRef);
+    }
+    return !isAborted();
+}
+
+// Range of V along the edge from -> to (getEdgeRange of the fixpoint), empty when the edge is infeasible
+BranchRangeQuery::Range BranchRangeQuery::getEdgeRange(BasicBlock *from, BasicBlock *to, Value *V)
+{
+    if (!isFeasibleEdge(from, to))
+    {
+        return BranchRangeInfo::getEmptyRange(V->getType()->getIntegerBitWidth());
+    }
+
+    Range valRefSource = readRange(V, from);
+    Range rangeCmpTaken;
+    Range rangeCmpNotTaken;
+    if (getComparedValue(from, &rangeCmpTaken, &rangeCmpNotTaken) != V)
+    {
+        return valRefSource;
+    }
+
+    // Both successors can be the same basic block
+    BranchRangeSolver solver;
+    BranchInst *brInst = cast<BranchInst>(from->getTerminator());
+    Range rangeEdge = BranchRangeInfo::getEmptyRange(V->getType()->getIntegerBitWidth());
+    if (brInst->getSuccessor(0) == to)
+    {
+        rangeEdge = solver.unionOpe(rangeEdge, solver.brOpe(valRefSource, rangeCmpTaken));
+    }
+    if (brInst->getSuccessor(1) == to)
+    {
+        rangeEdge = solver.unionOpe(rangeEdge, solver.brOpe(valRefSource, rangeCmpNotTaken));
+    }
+    return rangeEdge;
+}
+
+// Edge not pruned by the branch of from (-branch-range-prune-edges), whether from is reached is not known
+bool BranchRangeQuery::isFeasibleEdge(BasicBlock *from, BasicBlock *to)
+{
+    Range rangeCmpTaken;
+    Range rangeCmpNotTaken;
+    Value *oper = getComparedValue(from, &rangeCmpTaken, &rangeCmpNotTaken);
+    if (!PruneEdges || oper == nullptr)
+    {
+        return true;
+    }
+
+    BranchRangeSolver solver;
+    Range valRefSource = readRange(oper, from);
+    bool isTaken0 = !solver.isEmptyRange(solver.brOpe(valRefSource, rangeCmpTaken));
+    bool isTaken1 = !solver.isEmptyRange(solver.brOpe(valRefSource, rangeCmpNotTaken));
+    BranchInst *brInst = cast<BranchInst>(from->getTerminator());
+    if (brInst->getSuccessor(0) == brInst->getSuccessor(1))
+    {
+        return isTaken0 || isTaken1;
+    }
+    return brInst->getSuccessor(0) == to ? isTaken0 : isTaken1;
+}
+
+bool BranchRangeQuery::isDefinedIn(Value *V, BasicBlock *BB)
+{
+    auto *I = dyn_cast<Instruction>(V);
+    return I != nullptr && I->getParent() == BB;
+}
+
+// Value compared by the br-complex of from and its ranges on the taken and not taken edges
+// (nullptr when from does not branch on a cmp of a reference, see getBranchRanges)
+Value *BranchRangeQuery::getComparedValue(BasicBlock *from, Range *rangeTaken, Range *rangeNotTaken)
+{
+    auto *brInst = dyn_cast_or_null<BranchInst>(from->getTerminator());
+    if (brInst == nullptr || brInst->isUnconditional())
+    {
+        return nullptr;
+    }
+
+    auto *cmpInst = dyn_cast<CmpInst>(brInst->getCondition());
+    if (cmpInst == nullptr || (!cmpInst->getOperand(0)->hasName() && !cmpInst->getOperand(1)->hasName()))
+    {
+        return nullptr;
+    }
+    return BranchRangeSolver().getBranchRanges(cmpInst, rangeTaken, rangeNotTaken);
+}
+
+
+bool BranchRangeInfo::invalidate(Function &, const PreservedAnalyses &PA, FunctionAnalysisManager::Invalidator &)
+{
+    // Any change of the instructions can change the ranges: invalidated unless the pass preserves it
+    PreservedAnalyses::PreservedAnalysisChecker checker = PA.getChecker<BranchRangeAnalysis>();
+    return !checker.preserved() && !checker.preservedSet<AllAnalysesOn<Function>>();
+}
+
+AnalysisKey BranchRangeAnalysis::Key;
+
+BranchRangeInfo BranchRangeAnalysis::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    BranchRangeInfo info;
+    BranchRangeSolver().run(Func, &FAM.getResult<DominatorTreeAnalysis>(Func), &info);
+    return info;
+}
+
+PreservedAnalyses BranchRangePrinterPass::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    FAM.getResult<BranchRangeAnalysis>(Func).print(OS);
+    return PreservedAnalyses::all();
+}
+
+PreservedAnalyses BranchRangeQueryPrinterPass::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    BranchRangeQuery query(Func, FAM.getResult<DominatorTreeAnalysis>(Func));
+    OS << "--- RANGE-QUERIES ---\n";
+    OS << "Function: " << Func.getName() << "\n";
+    for (BasicBlock &BB : Func)
+    {
+        for (Instruction &I : BB)
+        {
+            // Loop bounds and guards (compared values of the branches), array indexes
+            SmallVector<Value *, 4> queried;
+            auto *brInst = dyn_cast<BranchInst>(&I);
+            if (brInst != nullptr && brInst->isConditional() && isa<ICmpInst>(brInst->getCondition()))
             {
-                valString += rangeVal.first == infMin ? "-Inf" : std::to_string(rangeVal.first);
-                valString += ", ";
-                valString += rangeVal.second == infMax ? "+Inf" : std::to_string(rangeVal.second);
-                valString += ")";
+                queried.append(cast<ICmpInst>(brInst->getCondition())->op_begin(), cast<ICmpInst>(brInst->getCondition())->op_end());
             }
-            else
+            else if (auto *gepInst = dyn_cast<GetElementPtrInst>(&I))
             {
-                valString += rangeVal.second == infMax ? "+Inf" : std::to_string(rangeVal.second);
-                valString += ", ";
-                valString += rangeVal.first == infMin ? "-Inf" : std::to_string(rangeVal.first);
-                valString += ")";
+                queried.append(gepInst->idx_begin(), gepInst->idx_end());
             }
 
-            return valString;
+            for (Value *V : queried)
+            {
+                if (V->hasName() && V->getType()->isIntegerTy() && (QueryValues.empty() || is_contained(QueryValues, V->getName())))
+                {
+                    OS << "   " << V->getName() << " [" << BB.getName() << "] " << printRange(query.getRangeAt(V, &BB)) << "\n";
+                }
+            }
         }
-    }; // namespace
-} // end of anonymous namespace
+    }
+    OS << "Queries: " << query.counters.queries << ", memoized: " << query.counters.memoHits << ", evaluations: " << query.counters.evaluations
+       << ", fixpoint: " << query.counters.fallbacks << "\n\n";
+    return PreservedAnalyses::all();
+}
+
+PreservedAnalyses BranchRangeModulePrinterPass::run(Module &M, ModuleAnalysisManager &)
+{
+    std::vector<BranchRangeInfo> results;
+    computeModuleRanges(M, &results);
+    for (const BranchRangeInfo &info : results)
+    {
+        info.print(OS);
+    }
+    return PreservedAnalyses::all();
+}
+
 
 char HppsBranchRange::ID = 0;
 static RegisterPass<HppsBranchRange> X("branch-range", "Branch Range Pass",
                                        false /* Only looks at CFG */,
                                        false /* Analysis Pass */);
 
+char HppsBranchRangeModule::ID = 0;
+static RegisterPass<HppsBranchRangeModule> XM("branch-range-module", "Branch Range Pass (parallel over the functions of a module)",
+                                              false /* Only looks at CFG */,
+                                              false /* Analysis Pass */);
+
 static RegisterStandardPasses Y(
     PassManagerBuilder::EP_EarlyAsPossible,
-    [](const PassManagerBuilder &Builder,
+    [](const PassManagerBuilder &,
        legacy::PassManagerBase &PM) { PM.add(new HppsBranchRange()); });
+
+// New pass manager: opt -load-pass-plugin=LLVMBranchRange.so -passes='print<branch-range>'
+// (module driver: -passes='print<branch-range-module>')
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo()
+{
+    return {LLVM_PLUGIN_API_VERSION, "BranchRange", LLVM_VERSION_STRING,
+            [](PassBuilder &PB) {
+                PB.registerAnalysisRegistrationCallback(
+                    [](FunctionAnalysisManager &FAM) { FAM.registerPass([] { return BranchRangeAnalysis(); }); });
+                PB.registerPipelineParsingCallback(
+                    [](StringRef Name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
+                        if (Name == "print<branch-range>")
+                        {
+                            FPM.addPass(BranchRangePrinterPass(errs()));
+                            return true;
+                        }
+                        if (Name == "print<branch-range-query>")
+                        {
+                            FPM.addPass(BranchRangeQueryPrinterPass(errs()));
+                            return true;
+                        }
+                        if (Name == "require<branch-range>")
+                        {
+                            FPM.addPass(RequireAnalysisPass<BranchRangeAnalysis, Function>());
+                            return true;
+                        }
+                        if (Name == "branch-range-bitwidth")
+                        {
+                            FPM.addPass(BranchRangeBitWidthPass(errs()));
+                            return true;
+                        }
+                        if (Name == "branch-range-annotate")
+                        {
+                            FPM.addPass(BranchRangeAnnotatePass(errs()));
+                            return true;
+                        }
+                        if (Name == "branch-range-bounds-check")
+                        {
+                            FPM.addPass(BranchRangeBoundsCheckPass(errs()));
+                            return true;
+                        }
+                        if (Name == "branch-range-prune")
+                        {
+                            FPM.addPass(BranchRangePrunePass(errs()));
+                            return true;
+                        }
+                        if (Name == "branch-range-strength")
+                        {
+                            FPM.addPass(BranchRangeStrengthPass(errs()));
+                            return true;
+                        }
+                        if (Name == "branch-range-loop-metadata")
+                        {
+                            FPM.addPass(BranchRangeLoopMetadataPass(errs()));
+                            return true;
+                        }
+                        return false;
+                    });
+                PB.registerPipelineParsingCallback(
+                    [](StringRef Name, ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+                        if (Name == "print<branch-range-module>")
+                        {
+                            MPM.addPass(BranchRangeModulePrinterPass(errs()));
+                            return true;
+                        }
+                        return false;
+                    });
+            }};
+}
@@ -0,0 +1,268 @@
+#ifndef BRANCH_RANGE_H
+#define BRANCH_RANGE_H
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/PassManager.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace llvm
+{
+    class BasicBlock;
+    class DominatorTree;
+    class Function;
+    class Instruction;
+    class Module;
+    class Value;
+    class raw_ostream;
+} // namespace llvm
+
+// Per-run counters of the fixpoint (and of the cache, see -branch-range-cache-dir)
+struct FixpointCounters
+{
+    unsigned iterations = 0;
+    unsigned blockVisits = 0;
+    unsigned evaluations = 0;
+    unsigned updates = 0;
+    unsigned reenqueues = 0;
+    unsigned widenings = 0;
+    unsigned valuesToTop = 0;
+    unsigned cacheHits = 0;
+    unsigned cacheMisses = 0;
+};
+
+// Counters of the demand-driven queries (see BranchRangeQuery)
+struct QueryCounters
+{
+    unsigned queries = 0;
+    unsigned memoHits = 0;
+    unsigned evaluations = 0;
+    unsigned fallbacks = 0;
+};
+
+// Value ranges of the branch-range analysis, for each visited basic block
+// {
+//      "BB1": { '%k', { 0, 100 } }
+// }
+// Ranges are signed intervals [min, max] in the bit width of the (integer) value
+// -Inf and +Inf are the signed min and max of the width, a value without range in a block is (-Inf, +Inf)
+class BranchRangeInfo
+{
+public:
+    typedef std::pair<llvm::APInt, llvm::APInt> Range;
+    typedef std::vector<std::pair<llvm::Value *, Range>> BlockRanges;
+
+    static Range getFullRange(unsigned bitWidth)
+    {
+        return Range(llvm::APInt::getSignedMinValue(bitWidth), llvm::APInt::getSignedMaxValue(bitWidth));
+    }
+
+    // Empty range (min > max): no execution reaches the value
+    static Range getEmptyRange(unsigned bitWidth)
+    {
+        return Range(llvm::APInt::getSignedMaxValue(bitWidth), llvm::APInt::getSignedMinValue(bitWidth));
+    }
+
+    static bool isEmptyRange(const Range &R)
+    {
+        return R.first.sgt(R.second);
+    }
+
+    bool isVisited(const llvm::BasicBlock *BB) const
+    {
+        return blockIndex.find(BB) != blockIndex.end();
+    }
+
+    bool hasRange(const llvm::BasicBlock *BB, const llvm::Value *V) const
+    {
+        return ranges.find(std::make_pair(BB, V)) != ranges.end();
+    }
+
+    // Range of V stored in BB, (-Inf, +Inf) when none
+    Range getRange(const llvm::BasicBlock *BB, const llvm::Value *V) const;
+
+    // Range of V used in BB: exact for a constant, range of its definition when BB has none
+    Range getValueRange(const llvm::BasicBlock *BB, const llvm::Value *V) const;
+
+    // Ranges stored in BB, in the order of the report
+    const BlockRanges &getBlockRanges(const llvm::BasicBlock *BB) const;
+
+    // Visited basic blocks in function order
+    const std::vector<llvm::BasicBlock *> &getVisitedBlocks() const
+    {
+        return visitedBlocks;
+    }
+
+    // CFG edge taken by the fixpoint: its source is reached and the compared value is not empty on it
+    // (a visited block without an executable edge to a successor never branches there)
+    bool isExecutableEdge(const llvm::BasicBlock *from, const llvm::BasicBlock *to) const
+    {
+        return executableEdges.count(std::make_pair(from, to));
+    }
+
+    // Edges of visited blocks that are not executable
+    unsigned countInfeasibleEdges() const;
+
+    // Maximum number of executions of the body of the counting loop whose condition is in header
+    // (number of values of the compared value on the taken edge, see maxTripcount), 0 when unknown
+    uint64_t getMaxTripcount(const llvm::BasicBlock *header) const
+    {
+        return tripcounts.lookup(header);
+    }
+
+    // Filled by the fixpoint, basic blocks in function order
+    void addBlock(llvm::BasicBlock *BB);
+    void addRange(llvm::BasicBlock *BB, llvm::Value *V, const Range &R);
+    void addEdge(llvm::BasicBlock *from, llvm::BasicBlock *to);
+    void addTripcount(llvm::BasicBlock *header, uint64_t tripcount);
+
+    // Incremental re-analysis after a transform changed the instructions of changedBlocks (blocks
+    // added, and successors of blocks removed, included), domTree being up to date: the blocks
+    // reachable from them are evaluated again, the ranges of the other blocks are kept
+    void update(llvm::Function &Func, llvm::DominatorTree &domTree, llvm::ArrayRef<llvm::BasicBlock *> changedBlocks);
+    void update(llvm::Function &Func, llvm::DominatorTree &domTree, llvm::ArrayRef<llvm::Instruction *> changedInstructions);
+
+    // "--- VALUE-RANGES ---" report (and counters with -branch-range-counters)
+    void print(llvm::raw_ostream &OS) const;
+
+    // Ranges hold pointers to the instructions, kept only while the analysis is preserved
+    bool invalidate(llvm::Function &Func, const llvm::PreservedAnalyses &PA, llvm::FunctionAnalysisManager::Invalidator &Inv);
+
+    FixpointCounters counters;
+
+private:
+    std::vector<llvm::BasicBlock *> visitedBlocks;
+    std::vector<BlockRanges> blockRanges;
+    llvm::DenseMap<const llvm::BasicBlock *, unsigned> blockIndex;
+    llvm::DenseMap<std::pair<const llvm::BasicBlock *, const llvm::Value *>, Range> ranges;
+    llvm::DenseSet<std::pair<const llvm::BasicBlock *, const llvm::BasicBlock *>> executableEdges;
+    llvm::DenseMap<const llvm::BasicBlock *, uint64_t> tripcounts;
+};
+
+// Demand-driven ranges of a function: getRangeAt evaluates only the backward slice of the query (the
+// definitions of its operands and the branches refining them up the dominator tree), same transfer
+// functions as the fixpoint, each range memoized for the later queries
+// A slice with a cycle (loop) falls back to the fixpoint of the whole function, computed once and
+// answering every later query. Without it, an edge is taken unless its own branch prunes it, a phi
+// operand coming from a block the fixpoint never reaches can widen the range (never narrow it)
+class BranchRangeQuery
+{
+public:
+    typedef BranchRangeInfo::Range Range;
+
+    // One scan of the branches of Func (refined blocks of each compared value)
+    BranchRangeQuery(llvm::Function &Func, llvm::DominatorTree &domTree);
+
+    // Range of the integer value V used in BB, as read by the fixpoint: the range in BB or in its closest
+    // dominator (BranchRangeInfo::getValueRange only looks at BB and at the definition of V), empty when
+    // no taken edge reaches BB
+    // The function must not change between the queries
+    Range getRangeAt(llvm::Value *V, llvm::BasicBlock *BB);
+
+    // True once a query has fallen back to the fixpoint
+    bool hasFixpoint() const
+    {
+        return fixpoint != nullptr;
+    }
+
+    QueryCounters counters;
+
+private:
+    llvm::Function &Func;
+    llvm::DominatorTree &domTree;
+    // Successors of the branches comparing a value, where the fixpoint stores its range
+    llvm::DenseMap<const llvm::Value *, llvm::SmallVector<llvm::BasicBlock *, 2>> refinedBlocks;
+    // Ranges stored in the definition and refined blocks (None when none)
+    llvm::DenseMap<std::pair<const llvm::BasicBlock *, const llvm::Value *>, llvm::Optional<Range>> memo;
+    llvm::DenseSet<std::pair<const llvm::BasicBlock *, const llvm::Value *>> inProgress;
+    std::unique_ptr<BranchRangeInfo> fixpoint;
+    // Set when the slice of the current query reaches a query in progress
+    bool hasCycle = false;
+    // Stored range where a slice too deep stopped (see getRangeAt), nullptr when none
+    std::pair<llvm::BasicBlock *, llvm::Value *> deepQuery = std::make_pair(nullptr, nullptr);
+    unsigned depth = 0;
+
+    // The current evaluation stops, the ranges computed until the query is retried are not final
+    bool isAborted() const
+    {
+        return hasCycle || deepQuery.first != nullptr;
+    }
+
+    Range readRange(llvm::Value *V, llvm::BasicBlock *BB);
+    Range getOperandRange(llvm::Value *V, llvm::BasicBlock *BB);
+    bool getStoredRange(llvm::Value *V, llvm::BasicBlock *BB, Range *R);
+    bool computeStoredRange(llvm::Value *V, llvm::BasicBlock *BB, Range *R);
+    bool getDefinitionRange(llvm::Instruction *I, llvm::BasicBlock *BB, Range *R);
+    Range getEdgeRange(llvm::BasicBlock *from, llvm::BasicBlock *to, llvm::Value *V);
+    bool isFeasibleEdge(llvm::BasicBlock *from, llvm::BasicBlock *to);
+    llvm::Value *getComparedValue(llvm::BasicBlock *from, Range *rangeTaken, Range *rangeNotTaken);
+    bool isDefinedIn(llvm::Value *V, llvm::BasicBlock *BB);
+};
+
+// New pass manager analysis, cached by the FunctionAnalysisManager
+class BranchRangeAnalysis : public llvm::AnalysisInfoMixin<BranchRangeAnalysis>
+{
+public:
+    typedef BranchRangeInfo Result;
+
+    Result run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+private:
+    friend llvm::AnalysisInfoMixin<BranchRangeAnalysis>;
+    static llvm::AnalysisKey Key;
+};
+
+// print<branch-range>: same report as the legacy -branch-range pass
+class BranchRangePrinterPass : public llvm::PassInfoMixin<BranchRangePrinterPass>
+{
+public:
+    explicit BranchRangePrinterPass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+    // Also run on optnone functions (clang -O0 output)
+    static bool isRequired() { return true; }
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// print<branch-range-query>: ranges of the compared values of the branches and of the indexes of the
+// getelementptr instructions, answered by a BranchRangeQuery (counters of the queries after each function)
+class BranchRangeQueryPrinterPass : public llvm::PassInfoMixin<BranchRangeQueryPrinterPass>
+{
+public:
+    explicit BranchRangeQueryPrinterPass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+    static bool isRequired() { return true; }
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// print<branch-range-module>: same report, functions of the module analyzed on a thread pool
+// (-branch-range-threads), printed in module order
+class BranchRangeModulePrinterPass : public llvm::PassInfoMixin<BranchRangeModulePrinterPass>
+{
+public:
+    explicit BranchRangeModulePrinterPass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Module &M, llvm::ModuleAnalysisManager &MAM);
+
+    static bool isRequired() { return true; }
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+#endif
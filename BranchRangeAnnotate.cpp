@@ -0,0 +1,205 @@
+#include "BranchRange.h"
+#include "BranchRangeKernels.h"
+#include "BranchRangeTransforms.h"
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/ConstantRange.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "branch-range-annotate"
+
+STATISTIC(NumNoWrapFlags, "nsw/nuw flags added");
+STATISTIC(NumAssumes, "llvm.assume inserted for the bounds of phis");
+
+static cl::opt<bool> AnnotateAssume("branch-range-annotate-assume",
+                                    cl::desc("Insert llvm.assume for the finite bounds of the integer phis (branch-range-annotate)"),
+                                    cl::init(false));
+
+namespace
+{
+    typedef BranchRangeInfo::Range Range;
+
+    // Facts of the ranges in a form the LLVM passes read, the instructions themselves are left unchanged:
+    // - nsw/nuw on add, sub, mul when the ranges of the operands cannot overflow
+    // - llvm.assume(v >= min), llvm.assume(v <= max) after the phis of a block (no metadata on phis),
+    //   for the bounds other than -Inf/+Inf, only with -branch-range-annotate-assume: the assume calls
+    //   keep the function from being inferred readnone/norecurse
+    class RangeAnnotation
+    {
+    public:
+        RangeAnnotation(Function &Func, const BranchRangeInfo &info) : Func(Func), info(info) {}
+
+        // Returns true when the function changed, report of the annotated instructions in OS
+        bool run(raw_ostream &OS)
+        {
+            OS << "--- ANNOTATIONS ---\n";
+            OS << "Function: " << Func.getName() << "\n";
+
+            unsigned flags = 0, assumes = 0;
+            ReversePostOrderTraversal<Function *> RPOT(&Func);
+            for (BasicBlock *BB : RPOT)
+            {
+                if (!info.isVisited(BB))
+                {
+                    continue;
+                }
+
+                std::vector<PHINode *> phis;
+                for (Instruction &I : *BB)
+                {
+                    if (auto *operInst = dyn_cast<OverflowingBinaryOperator>(&I))
+                    {
+                        flags += addNoWrapFlags(BB, cast<BinaryOperator>(operInst), OS);
+                    }
+                    else if (auto *phiInst = dyn_cast<PHINode>(&I))
+                    {
+                        phis.push_back(phiInst);
+                    }
+                }
+                if (AnnotateAssume)
+                {
+                    for (PHINode *phiInst : phis)
+                    {
+                        assumes += addAssumes(BB, phiInst, OS);
+                    }
+                }
+            }
+            OS << "Annotated: " << flags << " nsw/nuw flags, " << assumes << " llvm.assume\n\n";
+
+            NumNoWrapFlags += flags;
+            NumAssumes += assumes;
+            return flags + assumes != 0;
+        }
+
+    private:
+        Function &Func;
+        const BranchRangeInfo &info;
+
+        // Flags proven by the ranges of the operands in BB, returns the number of flags added
+        unsigned addNoWrapFlags(BasicBlock *BB, BinaryOperator *operInst, raw_ostream &OS)
+        {
+            unsigned operCode = operInst->getOpcode();
+            if (!operInst->getType()->isIntegerTy() || (operCode != Instruction::Add && operCode != Instruction::Sub && operCode != Instruction::Mul))
+            {
+                return 0;
+            }
+            Range range0 = info.getValueRange(BB, operInst->getOperand(0));
+            Range range1 = info.getValueRange(BB, operInst->getOperand(1));
+            if (BranchRangeInfo::isEmptyRange(range0) || BranchRangeInfo::isEmptyRange(range1))
+            {
+                return 0;
+            }
+
+            ConstantRange constRange0 = GenericInterval::toConstantRange(range0);
+            ConstantRange constRange1 = GenericInterval::toConstantRange(range1);
+            bool isNoSignedWrap = false, isNoUnsignedWrap = false;
+            switch (operCode)
+            {
+            case Instruction::Add:
+                isNoSignedWrap = constRange0.signedAddMayOverflow(constRange1) == ConstantRange::OverflowResult::NeverOverflows;
+                isNoUnsignedWrap = constRange0.unsignedAddMayOverflow(constRange1) == ConstantRange::OverflowResult::NeverOverflows;
+                break;
+            case Instruction::Sub:
+                isNoSignedWrap = constRange0.signedSubMayOverflow(constRange1) == ConstantRange::OverflowResult::NeverOverflows;
+                isNoUnsignedWrap = constRange0.unsignedSubMayOverflow(constRange1) == ConstantRange::OverflowResult::NeverOverflows;
+                break;
+            default:
+                isNoSignedWrap = isSignedMulInRange(range0, range1);
+                isNoUnsignedWrap = constRange0.unsignedMulMayOverflow(constRange1) == ConstantRange::OverflowResult::NeverOverflows;
+                break;
+            }
+
+            unsigned added = 0;
+            std::string report;
+            if (isNoSignedWrap && !operInst->hasNoSignedWrap())
+            {
+                operInst->setHasNoSignedWrap(true);
+                report += " nsw";
+                ++added;
+            }
+            if (isNoUnsignedWrap && !operInst->hasNoUnsignedWrap())
+            {
+                operInst->setHasNoUnsignedWrap(true);
+                report += " nuw";
+                ++added;
+            }
+            if (added != 0)
+            {
+                OS << "   " << operInst->getOpcodeName() << " " << operInst->getName() << ":" << report << "\n";
+            }
+            return added;
+        }
+
+        // Products of the bounds (extremes of a signed interval product) computed in twice the width
+        bool isSignedMulInRange(const Range &range0, const Range &range1)
+        {
+            unsigned width = range0.first.getBitWidth();
+            for (const APInt &bound0 : {range0.first, range0.second})
+            {
+                for (const APInt &bound1 : {range1.first, range1.second})
+                {
+                    if (!(bound0.sext(2 * width) * bound1.sext(2 * width)).isSignedIntN(width))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // llvm.assume of the finite bounds of a phi, after the phis of BB
+        unsigned addAssumes(BasicBlock *BB, PHINode *phiInst, raw_ostream &OS)
+        {
+            if (!phiInst->getType()->isIntegerTy())
+            {
+                return 0;
+            }
+            Range range = info.getRange(BB, phiInst);
+            if (BranchRangeInfo::isEmptyRange(range))
+            {
+                return 0;
+            }
+
+            IRBuilder<> builder(&*BB->getFirstInsertionPt());
+            unsigned assumes = 0;
+            if (!range.first.isMinSignedValue())
+            {
+                builder.CreateAssumption(builder.CreateICmpSGE(phiInst, builder.getInt(range.first)));
+                OS << "   phi " << phiInst->getName() << ": assume >= " << range.first << "\n";
+                ++assumes;
+            }
+            if (!range.second.isMaxSignedValue())
+            {
+                builder.CreateAssumption(builder.CreateICmpSLE(phiInst, builder.getInt(range.second)));
+                OS << "   phi " << phiInst->getName() << ": assume <= " << range.second << "\n";
+                ++assumes;
+            }
+            return assumes;
+        }
+    };
+} // namespace
+
+PreservedAnalyses BranchRangeAnnotatePass::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    const BranchRangeInfo &info = FAM.getResult<BranchRangeAnalysis>(Func);
+    if (!RangeAnnotation(Func, info).run(OS))
+    {
+        return PreservedAnalyses::all();
+    }
+
+    // Flags and assumes only: same blocks and branches
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
@@ -0,0 +1,333 @@
+#include "BranchRange.h"
+#include "BranchRangeTransforms.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "branch-range-bitwidth"
+
+STATISTIC(NumNarrowed, "Instructions rewritten in a narrower bit width");
+STATISTIC(NumBitsSaved, "Bits saved by the narrowed instructions");
+STATISTIC(NumConversions, "trunc/sext inserted between narrow and wide values");
+
+namespace
+{
+    typedef BranchRangeInfo::Range Range;
+
+    // Narrow widths tried, narrowest first (only widths narrower than the instruction)
+    const unsigned NarrowWidths[] = {8, 16, 32};
+
+    // Rewrites the narrowable instructions of a function in the narrowest width holding their ranges:
+    // - add, sub, mul, and, or, xor: the low N bits of the result only depend on the low N bits of
+    //   the operands, the result range alone decides the width (operands are truncated)
+    // - phi: the incoming values are the value of the phi, truncated to its width
+    // - icmp: both operands hold in the width (sext keeps the signed and the unsigned order)
+    // A narrow value used by a wide instruction is sign extended once, after its definition
+    class BitWidthNarrowing
+    {
+    public:
+        BitWidthNarrowing(Function &Func, const BranchRangeInfo &info) : Func(Func), info(info) {}
+
+        // Returns true when the function changed, report of the narrowed instructions in OS
+        bool run(raw_ostream &OS)
+        {
+            collectCandidates();
+
+            OS << "--- BIT-WIDTHS ---\n";
+            OS << "Function: " << Func.getName() << "\n";
+            unsigned bitsSaved = 0;
+            for (Instruction *I : candidates)
+            {
+                unsigned width = getWideWidth(I);
+                OS << "   " << I->getOpcodeName() << " " << I->getName() << ": i" << width << " -> i" << narrowWidth[I] << " (" << width - narrowWidth[I] << " bits)\n";
+                bitsSaved += width - narrowWidth[I];
+            }
+            OS << "Narrowed: " << candidates.size() << " instructions, " << bitsSaved << " bits saved\n\n";
+
+            if (candidates.empty())
+            {
+                return false;
+            }
+            rewrite();
+            NumNarrowed += candidates.size();
+            NumBitsSaved += bitsSaved;
+            return true;
+        }
+
+    private:
+        Function &Func;
+        const BranchRangeInfo &info;
+
+        // Narrowable instructions in reverse post-order (operands before users, phis aside)
+        std::vector<Instruction *> candidates;
+        DenseMap<Instruction *, unsigned> narrowWidth;
+
+        // Narrow instruction of each candidate, conversions of a value to a width (after its definition)
+        DenseMap<Instruction *, Instruction *> narrowValue;
+        DenseMap<std::pair<Value *, unsigned>, Value *> conversions;
+
+        void collectCandidates()
+        {
+            ReversePostOrderTraversal<Function *> RPOT(&Func);
+            for (BasicBlock *BB : RPOT)
+            {
+                if (!info.isVisited(BB))
+                {
+                    continue;
+                }
+                for (Instruction &I : *BB)
+                {
+                    unsigned width = getWideWidth(&I);
+                    if (width != 32 && width != 64)
+                    {
+                        continue;
+                    }
+
+                    unsigned narrow = width;
+                    if (auto *cmpInst = dyn_cast<ICmpInst>(&I))
+                    {
+                        narrow = std::max(getFitWidth(info.getValueRange(BB, cmpInst->getOperand(0)), width),
+                                          getFitWidth(info.getValueRange(BB, cmpInst->getOperand(1)), width));
+                    }
+                    else if (isa<PHINode>(I) || isNarrowableOperation(&I))
+                    {
+                        narrow = getFitWidth(info.getValueRange(BB, &I), width);
+                    }
+
+                    if (narrow < width)
+                    {
+                        candidates.push_back(&I);
+                        narrowWidth[&I] = narrow;
+                    }
+                }
+            }
+        }
+
+        // Width of the integer rewritten by I (operand width for icmp), 0 when none
+        unsigned getWideWidth(Instruction *I)
+        {
+            Type *type = isa<ICmpInst>(I) ? I->getOperand(0)->getType() : I->getType();
+            return type->isIntegerTy() ? type->getIntegerBitWidth() : 0;
+        }
+
+        bool isNarrowableOperation(Instruction *I)
+        {
+            switch (I->getOpcode())
+            {
+            case Instruction::Add:
+            case Instruction::Sub:
+            case Instruction::Mul:
+            case Instruction::And:
+            case Instruction::Or:
+            case Instruction::Xor:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // Narrowest width holding the signed range, width when none (or empty range: never executed)
+        unsigned getFitWidth(const Range &range, unsigned width)
+        {
+            if (BranchRangeInfo::isEmptyRange(range))
+            {
+                return width;
+            }
+            for (unsigned narrow : NarrowWidths)
+            {
+                if (narrow < width && range.first.isSignedIntN(narrow) && range.second.isSignedIntN(narrow))
+                {
+                    return narrow;
+                }
+            }
+            return width;
+        }
+
+        void rewrite()
+        {
+            // Phis first: incoming values can be defined later (loops), filled at the end
+            for (Instruction *I : candidates)
+            {
+                if (auto *phiInst = dyn_cast<PHINode>(I))
+                {
+                    Type *narrowType = IntegerType::get(Func.getContext(), narrowWidth[I]);
+                    narrowValue[I] = PHINode::Create(narrowType, phiInst->getNumIncomingValues(), "", phiInst);
+                }
+            }
+
+            for (Instruction *I : candidates)
+            {
+                if (isa<PHINode>(I))
+                {
+                    continue;
+                }
+                unsigned narrow = narrowWidth[I];
+                Value *narrow0 = getNarrowOperand(I->getOperand(0), narrow, I);
+                Value *narrow1 = getNarrowOperand(I->getOperand(1), narrow, I);
+                if (auto *cmpInst = dyn_cast<ICmpInst>(I))
+                {
+                    narrowValue[I] = new ICmpInst(I, cmpInst->getPredicate(), narrow0, narrow1);
+                }
+                else
+                {
+                    // No nsw/nuw: the narrow operation wraps where the wide one did not
+                    narrowValue[I] = BinaryOperator::Create(static_cast<Instruction::BinaryOps>(I->getOpcode()), narrow0, narrow1, "", I);
+                }
+            }
+
+            for (Instruction *I : candidates)
+            {
+                if (auto *phiInst = dyn_cast<PHINode>(I))
+                {
+                    PHINode *narrowPhi = cast<PHINode>(narrowValue[I]);
+                    for (unsigned incoming = 0; incoming < phiInst->getNumIncomingValues(); ++incoming)
+                    {
+                        BasicBlock *incomingBlock = phiInst->getIncomingBlock(incoming);
+                        narrowPhi->addIncoming(getNarrowOperand(phiInst->getIncomingValue(incoming), narrowWidth[I], incomingBlock->getTerminator()),
+                                               incomingBlock);
+                    }
+                }
+            }
+
+            // Wide users (not rewritten) read the sign extension of the narrow value
+            SmallPtrSet<Instruction *, 32> candidateSet(candidates.begin(), candidates.end());
+            for (Instruction *I : candidates)
+            {
+                Instruction *narrow = narrowValue[I];
+                if (isa<ICmpInst>(I))
+                {
+                    narrow->takeName(I);
+                    I->replaceAllUsesWith(narrow);
+                }
+                else
+                {
+                    SmallVector<Use *, 8> wideUses;
+                    for (Use &use : I->uses())
+                    {
+                        if (!candidateSet.count(cast<Instruction>(use.getUser())))
+                        {
+                            wideUses.push_back(&use);
+                        }
+                    }
+                    narrow->takeName(I);
+                    if (!wideUses.empty())
+                    {
+                        Value *ext = getConversion(narrow, I->getType()->getIntegerBitWidth(), /* isExtension */ true);
+                        for (Use *use : wideUses)
+                        {
+                            use->set(ext);
+                        }
+                    }
+                }
+            }
+
+            for (Instruction *I : candidates)
+            {
+                I->dropAllReferences();
+            }
+            for (Instruction *I : candidates)
+            {
+                I->eraseFromParent();
+            }
+        }
+
+        // V in the narrow width, for a user before insertBefore
+        Value *getNarrowOperand(Value *V, unsigned narrow, Instruction *insertBefore)
+        {
+            Type *narrowType = IntegerType::get(Func.getContext(), narrow);
+            if (auto *constInt = dyn_cast<ConstantInt>(V))
+            {
+                return ConstantInt::get(narrowType, constInt->getValue().trunc(narrow));
+            }
+            if (auto *constant = dyn_cast<Constant>(V))
+            {
+                return ConstantExpr::getTrunc(constant, narrowType);
+            }
+
+            // A narrow value holds its range: sext to a wider width, trunc to a narrower one
+            auto *I = dyn_cast<Instruction>(V);
+            if (I && narrowValue.count(I))
+            {
+                Value *narrowV = narrowValue[I];
+                unsigned width = narrowV->getType()->getIntegerBitWidth();
+                return width == narrow ? narrowV : getConversion(narrowV, narrow, width < narrow);
+            }
+
+            // Results of invoke/callbr are only available in the successors
+            if (I && I->isTerminator())
+            {
+                ++NumConversions;
+                return new TruncInst(V, narrowType, getConversionName(V, false), insertBefore);
+            }
+            return getConversion(V, narrow, /* isExtension */ false);
+        }
+
+        // trunc/sext of V to width, created once after the definition of V
+        Value *getConversion(Value *V, unsigned width, bool isExtension)
+        {
+            std::pair<Value *, unsigned> key(V, width);
+            auto found = conversions.find(key);
+            if (found != conversions.end())
+            {
+                return found->second;
+            }
+
+            Instruction *insertBefore;
+            if (auto *I = dyn_cast<Instruction>(V))
+            {
+                insertBefore = isa<PHINode>(I) ? &*I->getParent()->getFirstInsertionPt() : I->getNextNode();
+            }
+            else
+            {
+                insertBefore = &*Func.getEntryBlock().getFirstInsertionPt();
+            }
+
+            Type *type = IntegerType::get(Func.getContext(), width);
+            Instruction *conversion;
+            if (isExtension)
+            {
+                conversion = new SExtInst(V, type, getConversionName(V, true), insertBefore);
+            }
+            else
+            {
+                conversion = new TruncInst(V, type, getConversionName(V, false), insertBefore);
+            }
+            ++NumConversions;
+            conversions[key] = conversion;
+            return conversion;
+        }
+
+        // "k.sext", "k.trunc" (unnamed when V is)
+        std::string getConversionName(Value *V, bool isExtension)
+        {
+            return V->hasName() ? (V->getName() + (isExtension ? ".sext" : ".trunc")).str() : std::string();
+        }
+    };
+} // namespace
+
+PreservedAnalyses BranchRangeBitWidthPass::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    const BranchRangeInfo &info = FAM.getResult<BranchRangeAnalysis>(Func);
+    if (!BitWidthNarrowing(Func, info).run(OS))
+    {
+        return PreservedAnalyses::all();
+    }
+
+    // Same blocks and branches, new instructions: the ranges are recomputed
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    return PA;
+}
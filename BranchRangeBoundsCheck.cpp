@@ -0,0 +1,136 @@
+#include "BranchRange.h"
+#include "BranchRangeKernels.h"
+#include "BranchRangeTransforms.h"
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/ConstantRange.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+#include <utility>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "branch-range-bounds-check"
+
+STATISTIC(NumChecksRemoved, "Compares folded to true or false by the ranges of their operands");
+STATISTIC(NumBranchesFolded, "Conditional branches folded to an unconditional branch");
+STATISTIC(NumBlocksDeleted, "Basic blocks deleted after folding the branches");
+
+namespace
+{
+    typedef BranchRangeInfo::Range Range;
+
+    // Folds the compares decided by the ranges of their operands (i < N guards, i <u size checks of the
+    // sanitizers, ...), then the branches on a constant and the blocks no longer reachable
+    class BoundsCheckElimination
+    {
+    public:
+        BoundsCheckElimination(Function &Func, const BranchRangeInfo &info) : Func(Func), info(info) {}
+
+        // Returns true when the function changed, report of the removed checks in OS
+        bool run(raw_ostream &OS)
+        {
+            OS << "--- BOUNDS-CHECKS ---\n";
+            OS << "Function: " << Func.getName() << "\n";
+
+            // Decided with the ranges of the unchanged function, folded afterwards
+            SmallVector<std::pair<ICmpInst *, bool>, 16> decided;
+            ReversePostOrderTraversal<Function *> RPOT(&Func);
+            for (BasicBlock *BB : RPOT)
+            {
+                if (!info.isVisited(BB))
+                {
+                    continue;
+                }
+                for (Instruction &I : *BB)
+                {
+                    auto *cmpInst = dyn_cast<ICmpInst>(&I);
+                    bool result;
+                    if (cmpInst && decideCompare(BB, cmpInst, &result))
+                    {
+                        OS << "   icmp " << cmpInst->getName() << " [" << BB->getName() << "]: " << (result ? "true" : "false") << "\n";
+                        decided.push_back(std::make_pair(cmpInst, result));
+                    }
+                }
+            }
+
+            for (const std::pair<ICmpInst *, bool> &check : decided)
+            {
+                ICmpInst *cmpInst = check.first;
+                cmpInst->replaceAllUsesWith(ConstantInt::getBool(cmpInst->getType(), check.second));
+                cmpInst->eraseFromParent();
+            }
+
+            unsigned branches = 0;
+            for (BasicBlock &BB : Func)
+            {
+                auto *brInst = dyn_cast<BranchInst>(BB.getTerminator());
+                if (brInst && brInst->isConditional() && isa<ConstantInt>(brInst->getCondition()) && ConstantFoldTerminator(&BB, /* DeleteDeadConditions */ true))
+                {
+                    ++branches;
+                }
+            }
+            unsigned blocks = Func.size();
+            removeUnreachableBlocks(Func);
+            blocks -= Func.size();
+
+            OS << "Removed: " << decided.size() << " checks, " << branches << " branches folded, " << blocks << " blocks deleted\n\n";
+            NumChecksRemoved += decided.size();
+            NumBranchesFolded += branches;
+            NumBlocksDeleted += blocks;
+            return !decided.empty();
+        }
+
+    private:
+        Function &Func;
+        const BranchRangeInfo &info;
+
+        // True when the compare has the same result for every value of the ranges of its operands in BB
+        bool decideCompare(BasicBlock *BB, ICmpInst *cmpInst, bool *result)
+        {
+            if (!cmpInst->getOperand(0)->getType()->isIntegerTy())
+            {
+                return false;
+            }
+            Range range0 = info.getValueRange(BB, cmpInst->getOperand(0));
+            Range range1 = info.getValueRange(BB, cmpInst->getOperand(1));
+            if (BranchRangeInfo::isEmptyRange(range0) || BranchRangeInfo::isEmptyRange(range1))
+            {
+                return false;
+            }
+
+            ConstantRange constRange0 = GenericInterval::toConstantRange(range0);
+            ConstantRange constRange1 = GenericInterval::toConstantRange(range1);
+            if (constRange0.icmp(cmpInst->getPredicate(), constRange1))
+            {
+                *result = true;
+                return true;
+            }
+            if (constRange0.icmp(cmpInst->getInversePredicate(), constRange1))
+            {
+                *result = false;
+                return true;
+            }
+            return false;
+        }
+    };
+} // namespace
+
+PreservedAnalyses BranchRangeBoundsCheckPass::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    const BranchRangeInfo &info = FAM.getResult<BranchRangeAnalysis>(Func);
+    if (!BoundsCheckElimination(Func, info).run(OS))
+    {
+        return PreservedAnalyses::all();
+    }
+
+    // Branches and blocks removed
+    return PreservedAnalyses::none();
+}
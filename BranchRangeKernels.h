@@ -0,0 +1,327 @@
+#ifndef BRANCH_RANGE_KERNELS_H
+#define BRANCH_RANGE_KERNELS_H
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/IR/ConstantRange.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Operator.h"
+
+#include <cstdint>
+#include <utility>
+
+// Lattice operations of the branch-range analysis on signed intervals [min, max]
+// -Inf and +Inf are the signed min and max of the width, min > max is the empty range
+typedef std::pair<llvm::APInt, llvm::APInt> APIntInterval;
+
+// Machine integers of the fixed-width kernels: bounds (IntT) and sums without overflow (WideT)
+template <unsigned Width>
+struct IntervalTraits;
+
+template <>
+struct IntervalTraits<1>
+{
+    typedef int8_t IntT;
+    typedef int32_t WideT;
+};
+
+template <>
+struct IntervalTraits<8>
+{
+    typedef int8_t IntT;
+    typedef int32_t WideT;
+};
+
+template <>
+struct IntervalTraits<16>
+{
+    typedef int16_t IntT;
+    typedef int32_t WideT;
+};
+
+template <>
+struct IntervalTraits<32>
+{
+    typedef int32_t IntT;
+    typedef int64_t WideT;
+};
+
+template <>
+struct IntervalTraits<64>
+{
+    typedef int64_t IntT;
+    typedef __int128 WideT;
+};
+
+// Generic path, any bit width: APInt bounds, arithmetic on ConstantRange (signed hull of the result)
+struct GenericInterval
+{
+    static APIntInterval join(const APIntInterval &range0, const APIntInterval &range1)
+    {
+        if (isEmpty(range0))
+        {
+            return range1;
+        }
+        if (isEmpty(range1))
+        {
+            return range0;
+        }
+        return APIntInterval(llvm::APIntOps::smin(range0.first, range1.first), llvm::APIntOps::smax(range0.second, range1.second));
+    }
+
+    static APIntInterval meet(const APIntInterval &range0, const APIntInterval &range1)
+    {
+        return APIntInterval(llvm::APIntOps::smax(range0.first, range1.first), llvm::APIntOps::smin(range0.second, range1.second));
+    }
+
+    // range0 op range1, wrapping like the instruction (noWrapKind: OverflowingBinaryOperator flags)
+    // Add/Sub: a -Inf (+Inf) bound of an operand stays -Inf (+Inf), an unknown value is not shifted
+    static APIntInterval binaryOp(unsigned operCode, const APIntInterval &range0, const APIntInterval &range1, unsigned noWrapKind)
+    {
+        unsigned width = range0.first.getBitWidth();
+        if (isEmpty(range0) || isEmpty(range1))
+        {
+            return APIntInterval(llvm::APInt::getSignedMaxValue(width), llvm::APInt::getSignedMinValue(width));
+        }
+
+        llvm::Instruction::BinaryOps binOp = static_cast<llvm::Instruction::BinaryOps>(operCode);
+        llvm::ConstantRange constRange0 = toConstantRange(range0);
+        llvm::ConstantRange constRange1 = toConstantRange(range1);
+        APIntInterval result = fromConstantRange(noWrapKind != 0 ? constRange0.overflowingBinaryOp(binOp, constRange1, noWrapKind)
+                                                                 : constRange0.binaryOp(binOp, constRange1));
+        if (isEmpty(result) || (operCode != llvm::Instruction::Add && operCode != llvm::Instruction::Sub))
+        {
+            return result;
+        }
+
+        // b - c: the lower bound of c gives the upper bound of the result
+        bool isSub = operCode == llvm::Instruction::Sub;
+        const llvm::APInt &low1 = isSub ? range1.second : range1.first;
+        const llvm::APInt &high1 = isSub ? range1.first : range1.second;
+        if (range0.first.isMinSignedValue() || (isSub ? low1.isMaxSignedValue() : low1.isMinSignedValue()))
+        {
+            result.first = llvm::APInt::getSignedMinValue(width);
+        }
+        if (range0.second.isMaxSignedValue() || (isSub ? high1.isMinSignedValue() : high1.isMaxSignedValue()))
+        {
+            result.second = llvm::APInt::getSignedMaxValue(width);
+        }
+        return result;
+    }
+
+    static bool isEmpty(const APIntInterval &range)
+    {
+        return range.first.sgt(range.second);
+    }
+
+    static llvm::ConstantRange toConstantRange(const APIntInterval &range)
+    {
+        if (isEmpty(range))
+        {
+            return llvm::ConstantRange::getEmpty(range.first.getBitWidth());
+        }
+        return llvm::ConstantRange::getNonEmpty(range.first, range.second + 1);
+    }
+
+    static APIntInterval fromConstantRange(const llvm::ConstantRange &constRange)
+    {
+        if (constRange.isEmptySet())
+        {
+            unsigned width = constRange.getBitWidth();
+            return APIntInterval(llvm::APInt::getSignedMaxValue(width), llvm::APInt::getSignedMinValue(width));
+        }
+        return APIntInterval(constRange.getSignedMin(), constRange.getSignedMax());
+    }
+};
+
+// Kernels of a fixed bit width (i1, i8, i16, i32, i64) on machine integers, same results as GenericInterval
+// Sums are computed in WideT, where the overflow of the width is a comparison (no APInt, no ConstantRange)
+template <unsigned Width>
+struct FixedInterval
+{
+    typedef typename IntervalTraits<Width>::IntT IntT;
+    typedef typename IntervalTraits<Width>::WideT WideT;
+
+    IntT min;
+    IntT max;
+
+    static constexpr WideT minValue()
+    {
+        return -(WideT(1) << (Width - 1));
+    }
+
+    static constexpr WideT maxValue()
+    {
+        return (WideT(1) << (Width - 1)) - 1;
+    }
+
+    bool isEmpty() const
+    {
+        return min > max;
+    }
+
+    static FixedInterval full()
+    {
+        return {IntT(minValue()), IntT(maxValue())};
+    }
+
+    static FixedInterval empty()
+    {
+        return {IntT(maxValue()), IntT(minValue())};
+    }
+
+    static FixedInterval fromAPInt(const APIntInterval &range)
+    {
+        return {IntT(range.first.getSExtValue()), IntT(range.second.getSExtValue())};
+    }
+
+    APIntInterval toAPInt() const
+    {
+        return APIntInterval(llvm::APInt(Width, uint64_t(int64_t(min)), /* isSigned */ true),
+                             llvm::APInt(Width, uint64_t(int64_t(max)), /* isSigned */ true));
+    }
+
+    static FixedInterval join(FixedInterval range0, FixedInterval range1)
+    {
+        if (range0.isEmpty())
+        {
+            return range1;
+        }
+        if (range1.isEmpty())
+        {
+            return range0;
+        }
+        return {std::min(range0.min, range1.min), std::max(range0.max, range1.max)};
+    }
+
+    static FixedInterval meet(FixedInterval range0, FixedInterval range1)
+    {
+        return {std::max(range0.min, range1.min), std::min(range0.max, range1.max)};
+    }
+
+    // range0 + range1 (range0 - range1 with isSub), wrapping in Width bits or without signed overflow (nsw)
+    static FixedInterval addSub(FixedInterval range0, FixedInterval range1, bool isSub, bool isNoSignedWrap)
+    {
+        if (range0.isEmpty() || range1.isEmpty())
+        {
+            return empty();
+        }
+
+        WideT low = isSub ? WideT(range0.min) - range1.max : WideT(range0.min) + range1.min;
+        WideT high = isSub ? WideT(range0.max) - range1.min : WideT(range0.max) + range1.max;
+        FixedInterval result;
+        if (high - low + 1 >= (WideT(1) << Width))
+        {
+            // Every value of the width: nsw only keeps the results without overflow
+            result = isNoSignedWrap ? FixedInterval{saturate(low), saturate(high)} : full();
+        }
+        else if (low >= minValue() && high <= maxValue())
+        {
+            result = {IntT(low), IntT(high)};
+        }
+        else if (low > maxValue() || high < minValue())
+        {
+            // Every sum overflows: poison with nsw, shifted by 2^Width otherwise
+            WideT shift = low > maxValue() ? -(WideT(1) << Width) : (WideT(1) << Width);
+            result = isNoSignedWrap ? empty() : FixedInterval{IntT(low + shift), IntT(high + shift)};
+        }
+        else
+        {
+            // Some sums overflow: the wrapped values cover both ends of the width
+            result = isNoSignedWrap ? FixedInterval{saturate(low), saturate(high)} : full();
+        }
+        if (result.isEmpty())
+        {
+            return result;
+        }
+
+        // b - c: the lower bound of c gives the upper bound of the result
+        IntT low1 = isSub ? range1.max : range1.min;
+        IntT high1 = isSub ? range1.min : range1.max;
+        if (range0.min == minValue() || low1 == (isSub ? maxValue() : minValue()))
+        {
+            result.min = IntT(minValue());
+        }
+        if (range0.max == maxValue() || high1 == (isSub ? minValue() : maxValue()))
+        {
+            result.max = IntT(maxValue());
+        }
+        return result;
+    }
+
+    static IntT saturate(WideT value)
+    {
+        return IntT(value < minValue() ? minValue() : value > maxValue() ? maxValue() : value);
+    }
+};
+
+// Dispatch on the bit width of the value: fixed-width kernels for i1, i8, i16, i32, i64, GenericInterval otherwise
+struct IntervalKernels
+{
+    static APIntInterval join(const APIntInterval &range0, const APIntInterval &range1)
+    {
+        switch (range0.first.getBitWidth())
+        {
+        case 1:
+            return FixedInterval<1>::join(FixedInterval<1>::fromAPInt(range0), FixedInterval<1>::fromAPInt(range1)).toAPInt();
+        case 8:
+            return FixedInterval<8>::join(FixedInterval<8>::fromAPInt(range0), FixedInterval<8>::fromAPInt(range1)).toAPInt();
+        case 16:
+            return FixedInterval<16>::join(FixedInterval<16>::fromAPInt(range0), FixedInterval<16>::fromAPInt(range1)).toAPInt();
+        case 32:
+            return FixedInterval<32>::join(FixedInterval<32>::fromAPInt(range0), FixedInterval<32>::fromAPInt(range1)).toAPInt();
+        case 64:
+            return FixedInterval<64>::join(FixedInterval<64>::fromAPInt(range0), FixedInterval<64>::fromAPInt(range1)).toAPInt();
+        default:
+            return GenericInterval::join(range0, range1);
+        }
+    }
+
+    static APIntInterval meet(const APIntInterval &range0, const APIntInterval &range1)
+    {
+        switch (range0.first.getBitWidth())
+        {
+        case 1:
+            return FixedInterval<1>::meet(FixedInterval<1>::fromAPInt(range0), FixedInterval<1>::fromAPInt(range1)).toAPInt();
+        case 8:
+            return FixedInterval<8>::meet(FixedInterval<8>::fromAPInt(range0), FixedInterval<8>::fromAPInt(range1)).toAPInt();
+        case 16:
+            return FixedInterval<16>::meet(FixedInterval<16>::fromAPInt(range0), FixedInterval<16>::fromAPInt(range1)).toAPInt();
+        case 32:
+            return FixedInterval<32>::meet(FixedInterval<32>::fromAPInt(range0), FixedInterval<32>::fromAPInt(range1)).toAPInt();
+        case 64:
+            return FixedInterval<64>::meet(FixedInterval<64>::fromAPInt(range0), FixedInterval<64>::fromAPInt(range1)).toAPInt();
+        default:
+            return GenericInterval::meet(range0, range1);
+        }
+    }
+
+    // Add/Sub without nuw (see FixedInterval::addSub), any other operation on GenericInterval::binaryOp
+    static APIntInterval binaryOp(unsigned operCode, const APIntInterval &range0, const APIntInterval &range1, unsigned noWrapKind)
+    {
+        bool isAddSub = operCode == llvm::Instruction::Add || operCode == llvm::Instruction::Sub;
+        if (!isAddSub || (noWrapKind & llvm::OverflowingBinaryOperator::NoUnsignedWrap))
+        {
+            return GenericInterval::binaryOp(operCode, range0, range1, noWrapKind);
+        }
+
+        bool isSub = operCode == llvm::Instruction::Sub;
+        bool isNoSignedWrap = noWrapKind & llvm::OverflowingBinaryOperator::NoSignedWrap;
+        switch (range0.first.getBitWidth())
+        {
+        case 1:
+            return FixedInterval<1>::addSub(FixedInterval<1>::fromAPInt(range0), FixedInterval<1>::fromAPInt(range1), isSub, isNoSignedWrap).toAPInt();
+        case 8:
+            return FixedInterval<8>::addSub(FixedInterval<8>::fromAPInt(range0), FixedInterval<8>::fromAPInt(range1), isSub, isNoSignedWrap).toAPInt();
+        case 16:
+            return FixedInterval<16>::addSub(FixedInterval<16>::fromAPInt(range0), FixedInterval<16>::fromAPInt(range1), isSub, isNoSignedWrap).toAPInt();
+        case 32:
+            return FixedInterval<32>::addSub(FixedInterval<32>::fromAPInt(range0), FixedInterval<32>::fromAPInt(range1), isSub, isNoSignedWrap).toAPInt();
+        case 64:
+            return FixedInterval<64>::addSub(FixedInterval<64>::fromAPInt(range0), FixedInterval<64>::fromAPInt(range1), isSub, isNoSignedWrap).toAPInt();
+        default:
+            return GenericInterval::binaryOp(operCode, range0, range1, noWrapKind);
+        }
+    }
+};
+
+#endif
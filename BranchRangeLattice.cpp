@@ -0,0 +1,91 @@
+#include "BranchRangeLattice.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/ConstantRange.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+IntervalLattice::Range IntervalLattice::full(unsigned width)
+{
+    return Range(APInt::getSignedMinValue(width), APInt::getSignedMaxValue(width));
+}
+
+IntervalLattice::Range IntervalLattice::empty(unsigned width)
+{
+    return Range(APInt::getSignedMaxValue(width), APInt::getSignedMinValue(width));
+}
+
+bool IntervalLattice::isEmpty(const Range &range)
+{
+    return range.first.sgt(range.second);
+}
+
+IntervalLattice::Range IntervalLattice::join(const Range &range0, const Range &range1)
+{
+    return IntervalKernels::join(range0, range1);
+}
+
+IntervalLattice::Range IntervalLattice::meet(const Range &range0, const Range &range1)
+{
+    return IntervalKernels::meet(range0, range1);
+}
+
+IntervalLattice::Range IntervalLattice::phi(const Range &rangeSource0, const Range &rangeSource1)
+{
+    return join(rangeSource0, rangeSource1);
+}
+
+IntervalLattice::Range IntervalLattice::branch(const Range &rangeSource, const Range &rangeBranch)
+{
+    return meet(rangeBranch, rangeSource);
+}
+
+IntervalLattice::Range IntervalLattice::widen(const Range &rangeOld, const Range &rangeNew, const std::vector<APInt> &thresholds)
+{
+    unsigned width = rangeOld.first.getBitWidth();
+    auto signedLess = [](const APInt &lhs, const APInt &rhs) { return lhs.slt(rhs); };
+    Range rangeWiden = rangeOld;
+    if (rangeNew.first.slt(rangeOld.first))
+    {
+        std::vector<APInt>::const_iterator lowIt = std::upper_bound(thresholds.begin(), thresholds.end(), rangeNew.first, signedLess);
+        rangeWiden.first = lowIt == thresholds.begin() ? APInt::getSignedMinValue(width) : *(lowIt - 1);
+    }
+    if (rangeNew.second.sgt(rangeOld.second))
+    {
+        std::vector<APInt>::const_iterator highIt = std::lower_bound(thresholds.begin(), thresholds.end(), rangeNew.second, signedLess);
+        rangeWiden.second = highIt == thresholds.end() ? APInt::getSignedMaxValue(width) : *highIt;
+    }
+
+    return rangeWiden;
+}
+
+IntervalLattice::Range IntervalLattice::binaryOp(unsigned operCode, const Range &range0, const Range &range1, unsigned noWrapKind)
+{
+    return IntervalKernels::binaryOp(operCode, range0, range1, noWrapKind);
+}
+
+void IntervalLattice::compareRegions(CmpInst::Predicate pred, const APInt &cmpValue, Range *rangeTrue, Range *rangeFalse)
+{
+    ConstantRange regionTrue = ConstantRange::makeExactICmpRegion(pred, cmpValue);
+    *rangeTrue = GenericInterval::fromConstantRange(regionTrue);
+    *rangeFalse = GenericInterval::fromConstantRange(regionTrue.inverse());
+}
+
+std::string IntervalLattice::toString(const Range &range)
+{
+    // No execution reaches the value
+    if (isEmpty(range))
+    {
+        return "(Empty)";
+    }
+
+    std::string valString = "(";
+    valString += range.first.isMinSignedValue() ? "-Inf" : llvm::toString(range.first, 10, /* Signed */ true);
+    valString += ", ";
+    valString += range.second.isMaxSignedValue() ? "+Inf" : llvm::toString(range.second, 10, /* Signed */ true);
+    valString += ")";
+
+    return valString;
+}
@@ -0,0 +1,53 @@
+#ifndef BRANCH_RANGE_LATTICE_H
+#define BRANCH_RANGE_LATTICE_H
+
+#include "BranchRangeKernels.h"
+
+#include "llvm/ADT/APInt.h"
+#include "llvm/IR/InstrTypes.h"
+
+#include <string>
+#include <vector>
+
+// Interval domain of the branch-range analysis, without dependency on the pass (BranchRangeLattice.cpp)
+// Signed intervals [min, max] in the bit width of the value, -Inf and +Inf are the signed min and max
+// of the width, min > max is the empty range (no execution reaches the value)
+// Timed on its own by benchmarks/lattice-bench.sh
+struct IntervalLattice
+{
+    typedef APIntInterval Range;
+
+    static Range full(unsigned width);
+    static Range empty(unsigned width);
+    static bool isEmpty(const Range &range);
+
+    // Min of minimum values, max of maximum values (an empty range is ignored)
+    // i1/i8/i16/i32/i64 on the fixed-width kernels of BranchRangeKernels.h, APInt otherwise
+    static Range join(const Range &range0, const Range &range1);
+
+    // Max of minimum values, min of maximum values
+    static Range meet(const Range &range0, const Range &range1);
+
+    // Incoming ranges of a phi
+    static Range phi(const Range &rangeSource0, const Range &rangeSource1);
+
+    // Range of a value on the edge of a branch: its range in the source restricted to the compared region
+    static Range branch(const Range &rangeSource, const Range &rangeBranch);
+
+    // Widening: a bound still growing jumps to the next threshold (sorted, signed), -Inf/+Inf after the last one
+    static Range widen(const Range &rangeOld, const Range &rangeNew, const std::vector<llvm::APInt> &thresholds);
+
+    // range0 op range1 in the bit width of the operands, wrapping like the instruction (operCode:
+    // Instruction::BinaryOps, noWrapKind: OverflowingBinaryOperator flags)
+    static Range binaryOp(unsigned operCode, const Range &range0, const Range &range1, unsigned noWrapKind);
+
+    // Ranges of a value compared to cmpValue (value pred cmpValue) when the compare is true and false:
+    // exact region of the predicate and its complement (signed hull: a <u 10 false is (-Inf, +Inf),
+    // negative values are >= 10 unsigned)
+    static void compareRegions(llvm::CmpInst::Predicate pred, const llvm::APInt &cmpValue, Range *rangeTrue, Range *rangeFalse);
+
+    // "(min, max)", -Inf/+Inf for the signed min/max of the width, "(Empty)"
+    static std::string toString(const Range &range);
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "BranchRange.h"
+#include "BranchRangeTransforms.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "branch-range-loop-metadata"
+
+STATISTIC(NumLoopsAnnotated, "Loops with a tripcount from the ranges");
+STATISTIC(NumUnrollFull, "llvm.loop.unroll.full added to loops with a small tripcount");
+STATISTIC(NumTripcountWeights, "Exit branches given the branch weights of their tripcount");
+
+static cl::opt<unsigned> UnrollFullMax("branch-range-unroll-full-max",
+                                       cl::desc("Largest tripcount of the loops given llvm.loop.unroll.full (branch-range-loop-metadata)"),
+                                       cl::init(16));
+
+namespace
+{
+    // Tripcounts of the counting loops (BranchRangeInfo::getMaxTripcount) as hints for the loop unroller
+    // and the vectorizer, loops with their own llvm.loop.unroll metadata (pragmas) are left unchanged:
+    // - llvm.loop.unroll.full when the tripcount is at most -branch-range-unroll-full-max (no
+    //   llvm.loop.unroll.count: a count takes precedence over the full unrolling of a known tripcount)
+    // - branch weights tripcount:1 on the exit branch without !prof, read as the estimated
+    //   tripcount of the loop (getLoopEstimatedTripCount)
+    class LoopMetadataExport
+    {
+    public:
+        LoopMetadataExport(Function &Func, const BranchRangeInfo &info, LoopInfo &loopInfo) : Func(Func), info(info), loopInfo(loopInfo) {}
+
+        // Returns true when the function changed, report of the annotated loops in OS
+        bool run(raw_ostream &OS)
+        {
+            OS << "--- LOOP-METADATA ---\n";
+            OS << "Function: " << Func.getName() << "\n";
+
+            unsigned loops = 0, unrollFull = 0, weights = 0;
+            for (Loop *L : loopInfo.getLoopsInPreorder())
+            {
+                BranchInst *exitBr;
+                uint64_t tripcount = getLoopTripcount(L, &exitBr);
+                if (tripcount == 0)
+                {
+                    continue;
+                }
+                ++loops;
+                OS << "   loop " << L->getHeader()->getName() << ": tripcount " << tripcount;
+
+                if (tripcount <= UnrollFullMax && hasUnrollTransformation(L) == TM_Unspecified)
+                {
+                    setUnrollFull(L);
+                    OS << ", unroll full";
+                    ++unrollFull;
+                }
+
+                if (!exitBr->getMetadata(LLVMContext::MD_prof))
+                {
+                    // Weight of the successor staying in the loop first (branch weights are 32 bits)
+                    uint32_t loopWeight = static_cast<uint32_t>(std::min<uint64_t>(tripcount, UINT32_MAX));
+                    bool isExit0 = !L->contains(exitBr->getSuccessor(0));
+                    MDBuilder builder(Func.getContext());
+                    exitBr->setMetadata(LLVMContext::MD_prof, isExit0 ? builder.createBranchWeights(1, loopWeight) : builder.createBranchWeights(loopWeight, 1));
+                    OS << ", branch weights";
+                    ++weights;
+                }
+                OS << "\n";
+            }
+            OS << "Annotated: " << loops << " loops, " << unrollFull << " unroll full, " << weights << " branch weights\n\n";
+
+            NumLoopsAnnotated += loops;
+            NumUnrollFull += unrollFull;
+            NumTripcountWeights += weights;
+            return unrollFull + weights != 0;
+        }
+
+    private:
+        Function &Func;
+        const BranchRangeInfo &info;
+        LoopInfo &loopInfo;
+
+        // Smallest tripcount of the exiting condition blocks of L (header or latch), 0 when none
+        uint64_t getLoopTripcount(Loop *L, BranchInst **exitBr)
+        {
+            uint64_t loopTripcount = 0;
+            for (BasicBlock *BB : {L->getHeader(), L->getLoopLatch()})
+            {
+                uint64_t tripcount = BB ? info.getMaxTripcount(BB) : 0;
+                auto *brInst = tripcount ? dyn_cast<BranchInst>(BB->getTerminator()) : nullptr;
+                if (brInst == nullptr || brInst->isUnconditional() || !L->isLoopExiting(BB))
+                {
+                    continue;
+                }
+                if (loopTripcount == 0 || tripcount < loopTripcount)
+                {
+                    loopTripcount = tripcount;
+                    *exitBr = brInst;
+                }
+            }
+            return loopTripcount;
+        }
+
+        // New loop ID of L: its attributes and llvm.loop.unroll.full
+        void setUnrollFull(Loop *L)
+        {
+            MDNode *addAttributes[] = {MDNode::get(Func.getContext(), MDString::get(Func.getContext(), "llvm.loop.unroll.full"))};
+            L->setLoopID(makePostTransformationMetadata(Func.getContext(), L->getLoopID(), {}, addAttributes));
+        }
+    };
+} // namespace
+
+PreservedAnalyses BranchRangeLoopMetadataPass::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    const BranchRangeInfo &info = FAM.getResult<BranchRangeAnalysis>(Func);
+    LoopInfo &loopInfo = FAM.getResult<LoopAnalysis>(Func);
+    if (!LoopMetadataExport(Func, info, loopInfo).run(OS))
+    {
+        return PreservedAnalyses::all();
+    }
+
+    // Metadata only: same instructions, ranges and loops
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    PA.preserve<BranchRangeAnalysis>();
+    PA.preserve<LoopAnalysis>();
+    return PA;
+}
@@ -0,0 +1,93 @@
+#include "BranchRange.h"
+#include "BranchRangeTransforms.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "branch-range-prune"
+
+STATISTIC(NumBranchesPruned, "Conditional branches with an infeasible edge made unconditional");
+STATISTIC(NumBlocksPruned, "Basic blocks deleted after pruning the infeasible edges");
+
+namespace
+{
+    // Conditional branches of the visited blocks with exactly one executable edge (see
+    // BranchRangeInfo::isExecutableEdge) become unconditional, then the unreachable blocks are deleted
+    class EdgePruning
+    {
+    public:
+        EdgePruning(Function &Func, const BranchRangeInfo &info) : Func(Func), info(info) {}
+
+        // Returns true when the function changed, report of the pruned edges in OS
+        bool run(raw_ostream &OS)
+        {
+            OS << "--- PRUNED-EDGES ---\n";
+            OS << "Function: " << Func.getName() << "\n";
+
+            // Decided with the edges of the unchanged function, folded afterwards
+            SmallVector<std::pair<BranchInst *, unsigned>, 16> pruned;
+            for (BasicBlock *BB : info.getVisitedBlocks())
+            {
+                auto *brInst = dyn_cast<BranchInst>(BB->getTerminator());
+                if (brInst == nullptr || brInst->isUnconditional() || brInst->getSuccessor(0) == brInst->getSuccessor(1))
+                {
+                    continue;
+                }
+                bool isTaken0 = info.isExecutableEdge(BB, brInst->getSuccessor(0));
+                bool isTaken1 = info.isExecutableEdge(BB, brInst->getSuccessor(1));
+                if (isTaken0 != isTaken1)
+                {
+                    unsigned deadSucc = isTaken0 ? 1 : 0;
+                    OS << "   " << BB->getName() << " -> " << brInst->getSuccessor(deadSucc)->getName() << "\n";
+                    pruned.push_back(std::make_pair(brInst, deadSucc));
+                }
+            }
+
+            for (const std::pair<BranchInst *, unsigned> &edge : pruned)
+            {
+                BranchInst *brInst = edge.first;
+                BasicBlock *BB = brInst->getParent();
+                Value *condition = brInst->getCondition();
+                brInst->getSuccessor(edge.second)->removePredecessor(BB);
+                BranchInst::Create(brInst->getSuccessor(1 - edge.second), brInst);
+                brInst->eraseFromParent();
+                RecursivelyDeleteTriviallyDeadInstructions(condition);
+            }
+
+            unsigned blocks = Func.size();
+            if (!pruned.empty())
+            {
+                removeUnreachableBlocks(Func);
+            }
+            blocks -= Func.size();
+
+            OS << "Pruned: " << pruned.size() << " edges, " << blocks << " blocks deleted\n\n";
+            NumBranchesPruned += pruned.size();
+            NumBlocksPruned += blocks;
+            return !pruned.empty();
+        }
+
+    private:
+        Function &Func;
+        const BranchRangeInfo &info;
+    };
+} // namespace
+
+PreservedAnalyses BranchRangePrunePass::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    const BranchRangeInfo &info = FAM.getResult<BranchRangeAnalysis>(Func);
+    if (!EdgePruning(Func, info).run(OS))
+    {
+        return PreservedAnalyses::all();
+    }
+
+    // Branches and blocks removed
+    return PreservedAnalyses::none();
+}
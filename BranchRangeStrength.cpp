@@ -0,0 +1,271 @@
+#include "BranchRange.h"
+#include "BranchRangeTransforms.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <utility>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "branch-range-strength"
+
+STATISTIC(NumDivToShift, "sdiv by a power of two on a non-negative value turned into lshr");
+STATISTIC(NumRemToMask, "srem by a power of two on a non-negative value turned into and");
+STATISTIC(NumSignedToUnsignedDiv, "sdiv/srem of non-negative values turned into udiv/urem");
+STATISTIC(NumAShrToLShr, "ashr of a non-negative value turned into lshr");
+STATISTIC(NumSExtToZExt, "sext of a non-negative value turned into zext");
+STATISTIC(NumSignedToUnsignedCmp, "Signed compares of values of the same sign turned into unsigned compares");
+
+static cl::opt<bool> Incremental("branch-range-strength-incremental",
+                                 cl::desc("Update the ranges of the blocks reachable from the rewritten instructions instead of recomputing them (branch-range-strength)"),
+                                 cl::init(true));
+
+namespace
+{
+    typedef BranchRangeInfo::Range Range;
+
+    enum class Rewrite
+    {
+        DivToShift,
+        RemToMask,
+        DivToUDiv,
+        RemToURem,
+        AShrToLShr,
+        SExtToZExt,
+        SignedToUnsignedCmp
+    };
+
+    // Signed operations rewritten in their cheaper unsigned form when the ranges of the operands are non-negative:
+    // - sdiv x, 2^k -> lshr x, k and srem x, 2^k -> and x, 2^k - 1 (x >= 0)
+    // - sdiv/srem x, y -> udiv/urem x, y (x >= 0, y > 0)
+    // - ashr x, k -> lshr x, k and sext x -> zext x (x >= 0)
+    // - icmp slt/sle/sgt/sge -> ult/ule/ugt/uge (both operands >= 0 or both < 0)
+    class StrengthReduction
+    {
+    public:
+        StrengthReduction(Function &Func, const BranchRangeInfo &info) : Func(Func), info(info) {}
+
+        // Returns true when the function changed, report of the rewrites in OS
+        bool run(raw_ostream &OS)
+        {
+            OS << "--- STRENGTH-REDUCTION ---\n";
+            OS << "Function: " << Func.getName() << "\n";
+
+            // Decided with the ranges of the unchanged function (the new instructions have none), rewritten afterwards
+            SmallVector<std::pair<Instruction *, Rewrite>, 16> decided;
+            for (BasicBlock *BB : info.getVisitedBlocks())
+            {
+                for (Instruction &I : *BB)
+                {
+                    Rewrite rewrite;
+                    if (decideRewrite(BB, &I, &rewrite))
+                    {
+                        decided.push_back(std::make_pair(&I, rewrite));
+                    }
+                }
+            }
+
+            for (const std::pair<Instruction *, Rewrite> &reduction : decided)
+            {
+                if (changedBlocks.empty() || changedBlocks.back() != reduction.first->getParent())
+                {
+                    changedBlocks.push_back(reduction.first->getParent());
+                }
+            }
+
+            unsigned divToShift = 0, remToMask = 0, toUnsignedDiv = 0, ashrToLShr = 0, sextToZExt = 0, toUnsignedCmp = 0;
+            for (const std::pair<Instruction *, Rewrite> &reduction : decided)
+            {
+                applyRewrite(reduction.first, reduction.second, OS);
+                switch (reduction.second)
+                {
+                case Rewrite::DivToShift:
+                    ++divToShift;
+                    break;
+                case Rewrite::RemToMask:
+                    ++remToMask;
+                    break;
+                case Rewrite::DivToUDiv:
+                case Rewrite::RemToURem:
+                    ++toUnsignedDiv;
+                    break;
+                case Rewrite::AShrToLShr:
+                    ++ashrToLShr;
+                    break;
+                case Rewrite::SExtToZExt:
+                    ++sextToZExt;
+                    break;
+                case Rewrite::SignedToUnsignedCmp:
+                    ++toUnsignedCmp;
+                    break;
+                }
+            }
+            OS << "Reduced: " << divToShift << " sdiv->lshr, " << remToMask << " srem->and, " << toUnsignedDiv << " sdiv/srem->udiv/urem, "
+               << ashrToLShr << " ashr->lshr, " << sextToZExt << " sext->zext, " << toUnsignedCmp << " signed->unsigned icmp\n\n";
+
+            NumDivToShift += divToShift;
+            NumRemToMask += remToMask;
+            NumSignedToUnsignedDiv += toUnsignedDiv;
+            NumAShrToLShr += ashrToLShr;
+            NumSExtToZExt += sextToZExt;
+            NumSignedToUnsignedCmp += toUnsignedCmp;
+            return !decided.empty();
+        }
+
+        // Basic blocks of the rewritten instructions
+        ArrayRef<BasicBlock *> getChangedBlocks() const
+        {
+            return changedBlocks;
+        }
+
+    private:
+        Function &Func;
+        const BranchRangeInfo &info;
+        SmallVector<BasicBlock *, 16> changedBlocks;
+
+        // Cheaper form of I proven by the ranges of its operands in BB
+        bool decideRewrite(BasicBlock *BB, Instruction *I, Rewrite *rewrite)
+        {
+            if (!I->getType()->isIntegerTy())
+            {
+                return false;
+            }
+            switch (I->getOpcode())
+            {
+            case Instruction::ICmp:
+            {
+                auto *cmpInst = cast<ICmpInst>(I);
+                if (!cmpInst->isSigned() || !cmpInst->getOperand(0)->getType()->isIntegerTy())
+                {
+                    return false;
+                }
+                Range range0 = info.getValueRange(BB, cmpInst->getOperand(0));
+                Range range1 = info.getValueRange(BB, cmpInst->getOperand(1));
+                *rewrite = Rewrite::SignedToUnsignedCmp;
+                return (isNonNegative(range0) && isNonNegative(range1)) || (isNegative(range0) && isNegative(range1));
+            }
+            case Instruction::SDiv:
+            case Instruction::SRem:
+            {
+                Range divisorRange = info.getValueRange(BB, I->getOperand(1));
+                if (!isNonNegative(info.getValueRange(BB, I->getOperand(0))) || !isNonNegative(divisorRange) || divisorRange.first.isZero())
+                {
+                    return false;
+                }
+                bool isDiv = I->getOpcode() == Instruction::SDiv;
+                auto *constDivisor = dyn_cast<ConstantInt>(I->getOperand(1));
+                if (constDivisor && constDivisor->getValue().isPowerOf2())
+                {
+                    *rewrite = isDiv ? Rewrite::DivToShift : Rewrite::RemToMask;
+                }
+                else
+                {
+                    *rewrite = isDiv ? Rewrite::DivToUDiv : Rewrite::RemToURem;
+                }
+                return true;
+            }
+            case Instruction::AShr:
+                *rewrite = Rewrite::AShrToLShr;
+                return isNonNegative(info.getValueRange(BB, I->getOperand(0)));
+            case Instruction::SExt:
+                *rewrite = Rewrite::SExtToZExt;
+                return isNonNegative(info.getValueRange(BB, I->getOperand(0)));
+            default:
+                return false;
+            }
+        }
+
+        void applyRewrite(Instruction *I, Rewrite rewrite, raw_ostream &OS)
+        {
+            Value *oper0 = I->getOperand(0);
+            if (rewrite == Rewrite::SignedToUnsignedCmp)
+            {
+                auto *cmpInst = cast<ICmpInst>(I);
+                OS << "   icmp " << cmpInst->getName() << ": " << ICmpInst::getPredicateName(cmpInst->getPredicate()) << " -> "
+                   << ICmpInst::getPredicateName(cmpInst->getUnsignedPredicate()) << "\n";
+                cmpInst->setPredicate(cmpInst->getUnsignedPredicate());
+                return;
+            }
+            if (rewrite == Rewrite::SExtToZExt)
+            {
+                replace(I, new ZExtInst(oper0, I->getType(), "", I), OS);
+                return;
+            }
+
+            Value *oper1 = I->getOperand(1);
+            BinaryOperator *newInst;
+            switch (rewrite)
+            {
+            case Rewrite::DivToShift:
+                newInst = BinaryOperator::CreateLShr(oper0, ConstantInt::get(I->getType(), cast<ConstantInt>(oper1)->getValue().logBase2()), "", I);
+                break;
+            case Rewrite::RemToMask:
+                newInst = BinaryOperator::CreateAnd(oper0, ConstantInt::get(I->getType(), cast<ConstantInt>(oper1)->getValue() - 1), "", I);
+                break;
+            case Rewrite::DivToUDiv:
+                newInst = BinaryOperator::CreateUDiv(oper0, oper1, "", I);
+                break;
+            case Rewrite::RemToURem:
+                newInst = BinaryOperator::CreateURem(oper0, oper1, "", I);
+                break;
+            default:
+                newInst = BinaryOperator::CreateLShr(oper0, oper1, "", I);
+                break;
+            }
+            // exact: no bit shifted out / no remainder, same for the unsigned form of non-negative values
+            if (isa<PossiblyExactOperator>(newInst))
+            {
+                newInst->setIsExact(I->isExact());
+            }
+            replace(I, newInst, OS);
+        }
+
+        // newInst takes the name and the uses of I, I is erased
+        void replace(Instruction *I, Instruction *newInst, raw_ostream &OS)
+        {
+            OS << "   " << I->getOpcodeName() << " " << I->getName() << ": -> " << newInst->getOpcodeName() << "\n";
+            newInst->takeName(I);
+            I->replaceAllUsesWith(newInst);
+            I->eraseFromParent();
+        }
+
+        // Empty ranges (never executed) are left unchanged
+        bool isNonNegative(const Range &range)
+        {
+            return !BranchRangeInfo::isEmptyRange(range) && !range.first.isNegative();
+        }
+
+        bool isNegative(const Range &range)
+        {
+            return !BranchRangeInfo::isEmptyRange(range) && range.second.isNegative();
+        }
+    };
+} // namespace
+
+PreservedAnalyses BranchRangeStrengthPass::run(Function &Func, FunctionAnalysisManager &FAM)
+{
+    BranchRangeInfo &info = FAM.getResult<BranchRangeAnalysis>(Func);
+    StrengthReduction reduction(Func, info);
+    if (!reduction.run(OS))
+    {
+        return PreservedAnalyses::all();
+    }
+
+    // Same blocks and branches, new instructions: the ranges are recomputed, from the changed blocks only
+    PreservedAnalyses PA;
+    PA.preserveSet<CFGAnalyses>();
+    if (Incremental)
+    {
+        info.update(Func, FAM.getResult<DominatorTreeAnalysis>(Func), reduction.getChangedBlocks());
+        PA.preserve<BranchRangeAnalysis>();
+    }
+    return PA;
+}
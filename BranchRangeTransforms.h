@@ -0,0 +1,98 @@
+#ifndef BRANCH_RANGE_TRANSFORMS_H
+#define BRANCH_RANGE_TRANSFORMS_H
+
+#include "llvm/IR/PassManager.h"
+
+namespace llvm
+{
+    class raw_ostream;
+} // namespace llvm
+
+// Transformations driven by the ranges of BranchRangeAnalysis (new pass manager only)
+// Registered by the plugin of BranchRange.cpp, each one in its own source file
+
+// branch-range-bitwidth (BranchRangeBitWidth.cpp): i32/i64 arithmetic, phis and compares rewritten in the
+// narrowest width (i8, i16, i32) holding their ranges, trunc/sext only where narrow and wide values meet
+// Prints the instructions narrowed and the bits saved for each function
+class BranchRangeBitWidthPass : public llvm::PassInfoMixin<BranchRangeBitWidthPass>
+{
+public:
+    explicit BranchRangeBitWidthPass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// branch-range-annotate (BranchRangeAnnotate.cpp): nsw/nuw flags and, with -branch-range-annotate-assume,
+// llvm.assume of the bounds of phis, for the optimizations of LLVM
+// Prints the annotated instructions for each function
+class BranchRangeAnnotatePass : public llvm::PassInfoMixin<BranchRangeAnnotatePass>
+{
+public:
+    explicit BranchRangeAnnotatePass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// branch-range-bounds-check (BranchRangeBoundsCheck.cpp): compares decided by the ranges of their operands
+// (bounds checks, loop guards) folded to true or false, then the dead branches and blocks removed
+// Prints the removed checks for each function
+class BranchRangeBoundsCheckPass : public llvm::PassInfoMixin<BranchRangeBoundsCheckPass>
+{
+public:
+    explicit BranchRangeBoundsCheckPass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// branch-range-prune (BranchRangePrune.cpp): conditional branches with one infeasible edge (empty range of
+// the compared value, -branch-range-prune-edges) made unconditional, then the unreachable blocks removed
+// Prints the pruned edges for each function
+class BranchRangePrunePass : public llvm::PassInfoMixin<BranchRangePrunePass>
+{
+public:
+    explicit BranchRangePrunePass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// branch-range-strength (BranchRangeStrength.cpp): sdiv/srem by a power of two of a non-negative value become
+// lshr/and, the other signed operations of non-negative values (sdiv, srem, ashr, sext, icmp) their unsigned form
+// Prints the reduced instructions for each function
+class BranchRangeStrengthPass : public llvm::PassInfoMixin<BranchRangeStrengthPass>
+{
+public:
+    explicit BranchRangeStrengthPass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+// branch-range-loop-metadata (BranchRangeLoopMetadata.cpp): tripcounts of the counting loops as
+// llvm.loop.unroll.full (small tripcounts) and branch weights of the exit branch, for the unroller and the vectorizer
+// Prints the annotated loops for each function
+class BranchRangeLoopMetadataPass : public llvm::PassInfoMixin<BranchRangeLoopMetadataPass>
+{
+public:
+    explicit BranchRangeLoopMetadataPass(llvm::raw_ostream &OS) : OS(OS) {}
+
+    llvm::PreservedAnalyses run(llvm::Function &Func, llvm::FunctionAnalysisManager &FAM);
+
+private:
+    llvm::raw_ostream &OS;
+};
+
+#endif
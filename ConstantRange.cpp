@@ -1,296 +1,444 @@
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/InstrTypes.h"
 
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
 
 using namespace llvm;
 
+#define DEBUG_TYPE "const-range"
+
+// Single pass in reverse post-order: no block is scheduled again, variables stored in a loop are
+// widened to (-Inf, +Inf) at its header
+STATISTIC(NumBlockVisits, "Basic blocks evaluated");
+STATISTIC(NumEvaluations, "Instructions evaluated");
+STATISTIC(NumRangeUpdates, "Value ranges found");
+STATISTIC(NumWidenings, "Variables stored in a loop widened to (-Inf, +Inf) at its header");
+STATISTIC(NumValuesToTop, "add/sub results that went to (-Inf, +Inf)");
+
+// Trace of the pass (-debug-only=const-range), compiled out with NDEBUG like LLVM_DEBUG
+// Level 1: computed ranges, level 2: every instruction
+#ifndef NDEBUG
+#define TRACE(Level, ...)                                                         \
+  do                                                                              \
+  {                                                                               \
+    if (DebugFlag && isCurrentDebugType(DEBUG_TYPE) && TraceLevel >= (Level))     \
+    {                                                                             \
+      __VA_ARGS__;                                                                \
+    }                                                                             \
+  } while (false)
+#else
+#define TRACE(Level, ...) \
+  do                      \
+  {                       \
+  } while (false)
+#endif
+
 namespace
 {
+  // Detail of the trace (see TRACE)
+  static cl::opt<unsigned> TraceLevel(
+      "const-range-trace-level", cl::desc("Detail of the -debug-only=const-range trace (1: ranges, 2: every instruction)"),
+      cl::init(2));
 
-  struct HppsConstantRange : public FunctionPass
+  static cl::opt<bool> PrintCounters(
+      "const-range-counters", cl::desc("Print the evaluation counters after the value ranges"),
+      cl::init(false));
+
+  // Phases of a run timed with -time-passes or -stats
+  enum RangePhase
   {
-    static char ID;
-    HppsConstantRange() : FunctionPass(ID) {}
+    SetupPhase,
+    JoinPhase,
+    TransferPhase,
+    PrintPhase,
+    NumPhases
+  };
+
+  // Timers of the phases, reported in their own group when LLVM shuts down
+  struct PhaseTimers
+  {
+    PhaseTimers() : group("const-range", "Constant range analysis phases")
+    {
+      timers[SetupPhase].init("setup", "Variables and loops", group);
+      timers[JoinPhase].init("join", "Join of the predecessors (getEntryMemory)", group);
+      timers[TransferPhase].init("transfer", "Transfer functions (load, add/sub, store)", group);
+      timers[PrintPhase].init("print", "Report printing", group);
+    }
+
+    TimerGroup group;
+    Timer timers[NumPhases];
+  };
+
+  static ManagedStatic<PhaseTimers> phaseTimers;
+
+  // Timer of the phase, nullptr when not timed (TimeRegion does nothing)
+  Timer *getPhaseTimer(RangePhase phase)
+  {
+    return TimePassesIsEnabled || AreStatisticsEnabled() ? &phaseTimers->timers[phase] : nullptr;
+  }
+
+  // Constant ranges of a function, shared by the legacy and the new pass manager
+  // Single evaluation of the basic blocks in reverse post-order (clang -O0 output, no -mem2reg):
+  // - every instruction is defined before it is read, the interval of an operand is found in a hash index
+  // - allocas that do not escape (only loaded and stored) are forwarded from the last store to the
+  //   loads, the intervals of the predecessors are joined at the start of a block
+  // - at a loop header, the variables stored in the loop are unknown: (-Inf, +Inf), like other memory,
+  //   unsupported instructions and every variable at the entry of an irreducible cycle
+  //
+  // a = b + 1, a = 1 + b, a = b + c (add/sub of values or constants)
+  // a = b, a = 1 (store), b' = load b (alias of the variable)
+  struct ConstantRangeSolver
+  {
+    // Signed interval [minRange, maxRange], -Inf and +Inf are the minimum and maximum int
+    struct Interval
+    {
+      int minRange;
+      int maxRange;
+    };
+
+    // Intervals of the variables (allocas that do not escape) at a point of the function
+    typedef DenseMap<AllocaInst *, Interval> MemoryState;
 
     // Run over a single function (main)
-    bool runOnFunction(Function &Func) override
+    void run(Function &Func)
     {
-      // Create a Null Value reference
-      // Assigned as placeholder when no variable reference available
-      LLVMContext &context = Func.getContext();
-      Value *nullValue = ConstantInt::get(Type::getInt32Ty(context), -1);
-
-      // Keep reference of values still left to find the ranges
-      // 'from' is unknown, it depends on 'to', 'to2', 'toValue', and 'toOps' ('+' or '-')
-      //
-      // from = to toOps toValue (a = b + 1)
-      // from = toValue toOps to2 (a = 1 + b)
-      // from = to toOps to2 (a = b + c)
-      std::vector<Value *> from;
-      std::vector<Value *> to;
-      std::vector<Value *> to2;
-      std::vector<int> toValue;
-      std::vector<unsigned> toOps;
-
-      // Reference of variables for which range has been found
-      // Note: Since no branches, minRange = maxRange (constant values)
-      std::vector<Value *> ranged; // Reference to the variable (name)
-      std::vector<int> minRange;   // Min range of variable
-      std::vector<int> maxRange;   // Max range of variable
-
-      // Keep reference of variables (alias) from load instructions
-      std::vector<Value *> loadRef;
-
-      // Run over all basic blocks in the function
-      for (BasicBlock &BB : Func)
+      // Reference of variables for which range has been found, reported in this order:
+      // constants stored (a = 1), then the computed ones
+      std::vector<std::pair<Value *, Interval>> ranged;
+      std::vector<std::pair<Value *, Interval>> computed;
+
+      // Hash index: interval of each instruction and alias (load)
+      DenseMap<Value *, Interval> intervals;
+
+      // Variables forwarded from stores to loads, state at the end of each evaluated basic block
+      Timer *setupTimer = getPhaseTimer(SetupPhase);
+      if (setupTimer != nullptr)
+      {
+        setupTimer->startTimer();
+      }
+      SmallPtrSet<AllocaInst *, 16> variables;
+      DenseMap<BasicBlock *, MemoryState> blockMemory;
+      for (Instruction &I : Func.getEntryBlock())
+      {
+        auto *allocaInst = dyn_cast<AllocaInst>(&I);
+        if (allocaInst && allocaInst->getAllocatedType()->isIntegerTy() && isAllocaPromotable(allocaInst))
+        {
+          variables.insert(allocaInst);
+        }
+      }
+
+      // Variables stored in each loop (and its inner loops)
+      DominatorTree domTree(Func);
+      LoopInfo loopInfo(domTree);
+      DenseMap<Loop *, SmallPtrSet<AllocaInst *, 16>> loopStores;
+      for (AllocaInst *allocaInst : variables)
+      {
+        for (User *user : allocaInst->users())
+        {
+          auto *strInst = dyn_cast<StoreInst>(user);
+          if (strInst == nullptr)
+          {
+            continue;
+          }
+          for (Loop *L = loopInfo.getLoopFor(strInst->getParent()); L != nullptr; L = L->getParentLoop())
+          {
+            loopStores[L].insert(allocaInst);
+          }
+        }
+      }
+
+      // Run over all basic blocks in the function, predecessors first
+      ReversePostOrderTraversal<Function *> RPOT(&Func);
+      SmallPtrSet<BasicBlock *, 32> reachable(RPOT.begin(), RPOT.end());
+      if (setupTimer != nullptr)
+      {
+        setupTimer->stopTimer();
+      }
+      unsigned blockVisits = 0, evaluations = 0;
+      for (BasicBlock *BB : RPOT)
       {
+        ++blockVisits;
+        MemoryState memory;
+        {
+          TimeRegion joinRegion(getPhaseTimer(JoinPhase));
+          memory = getEntryMemory(BB, reachable, blockMemory, loopInfo, loopStores);
+        }
+
         // Run over all instructions in the basic block
-        for (Instruction &I : BB)
+        TimeRegion transferRegion(getPhaseTimer(TransferPhase));
+        for (Instruction &I : *BB)
         {
           // Print instruction
-          errs() << I << "\n";
+          TRACE(2, errs() << I << "\n");
+          ++evaluations;
 
-          // When instruction is load, store reference (alias) to its real variables
+          // When instruction is load, the alias has the interval of the last store to its variable
           if (auto *loadInst = dyn_cast<LoadInst>(&I))
           {
-            // Cycle over all the operands and store them for later use in 'loadRef'
-            // Used to identify references in binary operations
-            for (Use &U : loadInst->operands())
+            auto *allocaInst = dyn_cast<AllocaInst>(loadInst->getPointerOperand());
+            TRACE(2, errs() << "   -Load: " << loadInst->getPointerOperand()->getName() << "\n");
+            MemoryState::iterator found = allocaInst ? memory.find(allocaInst) : memory.end();
+            if (found != memory.end())
             {
-              Value *v = U.get();
-              loadRef.push_back(v);
-              errs() << "   -Load: " << v->getName() << "\n";
+              intervals[loadInst] = found->second;
             }
           }
 
           // When instruction is Add or Sub (a = a + c or a = b + 1 or a = 1 + b)
-          // Save operand0 (reference/constant) and operand1 (reference/constant)
-          if (auto *operInst = dyn_cast<BinaryOperator>(&I))
+          else if (auto *operInst = dyn_cast<BinaryOperator>(&I))
           {
             // Get operands from binary operation
             Value *oper0 = operInst->getOperand(0);
             Value *oper1 = operInst->getOperand(1);
 
-            // Store reference of variable still to find range
-            from.push_back(operInst);               // left-hand side of the operation
-            toOps.push_back(operInst->getOpcode()); // '+' ot '-'
-
             // Print variable assigned and name of operands
-            errs() << "   -Var: " << operInst->getName() << "\n";
-            errs() << "     -Op0: " << oper0->getName() << "\n";
-            errs() << "     -Op1: " << oper1->getName() << "\n";
+            TRACE(2, errs() << "   -Var: " << operInst->getName() << "\n");
+            TRACE(2, errs() << "     -Op0: " << oper0->getName() << "\n");
+            TRACE(2, errs() << "     -Op1: " << oper1->getName() << "\n");
 
-            // a = b + 1 (variable + constant)
-            // Get reference from previous load instruction
-            if (ConstantInt *CI = dyn_cast<ConstantInt>(oper1))
-            {
-              toValue.push_back(CI->getZExtValue());
-              to2.push_back(nullValue);
-
-              // If operand0 is reference (and not an alias) store it
-              if (oper0->hasName())
-              {
-                to.push_back(oper0);
-              }
-              // Otherwise get value from previous load instruction (alias)
-              else
-              {
-                to.push_back(loadRef.at(0));
-                loadRef.pop_back();
-              }
-            }
+            Interval refValue1 = getInterval(oper0, intervals);
+            Interval refValue2 = getInterval(oper1, intervals);
 
-            // a = 1 + b (constant + variable)
-            // Get reference from previous load instruction
-            else if (ConstantInt *CI = dyn_cast<ConstantInt>(oper0))
+            // Compute found value-range from resolved operands
+            if ((operInst->getOpcode() == Instruction::Add || operInst->getOpcode() == Instruction::Sub) && operInst->getType()->isIntegerTy())
             {
-              toValue.push_back(CI->getZExtValue());
-              to.push_back(nullValue);
-
-              // If operand1 is reference (and not an alias) store it
-              if (oper1->hasName())
-              {
-                to2.push_back(oper1);
-              }
-              // Otherwise get value from previous load instruction (alias)
-              else
-              {
-                to2.push_back(loadRef.at(0));
-                loadRef.pop_back();
-              }
-            }
-
-            // a = b + c (variable + variable)
-            // Get reference from two previous load instructions
-            else
-            {
-              toValue.push_back(0); // Placeholder
-
-              // Both operand0 and operand1 as reference
-              if (oper0->hasName() && oper1->hasName())
-              {
-                to.push_back(oper0);
-                to2.push_back(oper1);
-              }
-              // Operand0 from load and operand1 as reference
-              else if (!oper0->hasName() && oper1->hasName())
-              {
-                to.push_back(loadRef.at(0));
-                to2.push_back(oper1);
-                loadRef.pop_back();
-              }
-              // Operand1 from load and operand0 as reference
-              else if (oper0->hasName() && !oper1->hasName())
-              {
-                to.push_back(oper0);
-                to2.push_back(loadRef.at(0));
-                loadRef.pop_back();
-              }
-              // Both operand0 and operand1 from load (alias)
-              else
-              {
-                to.push_back(loadRef.at(0));
-                to2.push_back(loadRef.at(1));
-                loadRef.pop_back();
-                loadRef.pop_back();
-              }
+              bool isSub = operInst->getOpcode() == Instruction::Sub;
+              Interval result = addSubOpe(refValue1, refValue2, isSub, operInst->getType()->getIntegerBitWidth());
+              NumValuesToTop += result.minRange == std::numeric_limits<int>::min() && result.maxRange == std::numeric_limits<int>::max();
+              addRange(operInst, result, &computed);
+              intervals[operInst] = result;
+              TRACE(1, errs() << "  " << operInst->getName() << " = " << printInterval(refValue1) << (isSub ? " - " : " + ")
+                              << printInterval(refValue2) << " = " << printInterval(result) << "\n\n");
             }
           }
 
           // When instruction is store (a = b or a = 1)
-          if (auto *strInst = dyn_cast<StoreInst>(&I))
+          else if (auto *strInst = dyn_cast<StoreInst>(&I))
           {
             // Get operand0 (value) and operand1 (assigned)
             // operand1 = operand0
             Value *oper0 = strInst->getOperand(0);
             Value *oper1 = strInst->getOperand(1);
+            Interval refValue = getInterval(oper0, intervals);
 
-            // Store reference to variable still to find range
-            // a = b
-            if (oper0->hasName())
+            // Store constant range value (Value-Range Found!)
+            // a = 1 (variable assigned constant value)
+            if (isa<ConstantInt>(oper0))
             {
-              errs() << "   -Ref: " << oper0->getName() << "\n";
-              from.push_back(oper1); // a
-              to.push_back(oper0);   // b
-
-              to2.push_back(nullValue);          // Placeholder
-              toValue.push_back(0);              // Placeholder
-              toOps.push_back(Instruction::Add); // Placeholder
+              TRACE(2, errs() << "   -Range found: " << refValue.minRange << "\n");
+              addRange(oper1, refValue, &ranged);
             }
 
-            // Store constant range value (Value-Range Found!)
-            // a = 1 (variable assigned constant value)
+            // a = b (variable assigned the interval of a value)
             else
             {
-              if (ConstantInt *CI = dyn_cast<ConstantInt>(oper0))
-              {
-                errs() << "   -Range found: " << CI->getZExtValue() << "\n";
-
-                // Store found value-range
-                ranged.push_back(oper1);
-                minRange.push_back(CI->getZExtValue());
-                maxRange.push_back(CI->getZExtValue());
-              }
+              TRACE(2, errs() << "   -Ref: " << oper0->getName() << "\n");
+              addRange(oper1, refValue, &computed);
+              TRACE(1, errs() << "  " << oper1->getName() << " = " << printInterval(refValue) << "\n\n");
+            }
+
+            // Last store of the variable, read by the next loads
+            auto *allocaInst = dyn_cast<AllocaInst>(oper1);
+            if (allocaInst && variables.count(allocaInst))
+            {
+              memory[allocaInst] = refValue;
             }
           }
 
-          errs() << "\n";
+          TRACE(2, errs() << "\n");
         }
+
+        blockMemory[BB] = std::move(memory);
       }
 
-      // Resolve references/dependencies
-      errs() << "\n--- REFERENCES ---\n";
-      for (unsigned i = 0; i < from.size(); ++i)
+      NumBlockVisits += blockVisits;
+      NumEvaluations += evaluations;
+      NumRangeUpdates += ranged.size() + computed.size();
+
+      // Print value range computed
+      TimeRegion printRegion(getPhaseTimer(PrintPhase));
+      ranged.insert(ranged.end(), computed.begin(), computed.end());
+      errs() << "\n--- VALUE RANGES ---\n";
+      for (const std::pair<Value *, Interval> &valueRange : ranged)
       {
-        // Print all dependencies
-        errs() << from.at(i)->getName() << "(";
-        if (to.at(i) == nullValue)
-        {
-          errs() << toValue.at(i) << ", ";
-        }
-        else
-        {
-          errs() << to.at(i)->getName() << ", ";
-        }
-        if (to2.at(i) == nullValue)
-        {
-          errs() << toValue.at(i) << ")\n";
-        }
-        else
-        {
-          errs() << to2.at(i)->getName() << ")\n";
-        }
+        errs() << " " << valueRange.first->getName() << printInterval(valueRange.second) << "\n";
+      }
 
-        // Get value from ranged ranges
-        int refValue1 = -1;
-        int refValue2 = -1;
+      // Single pass: one iteration for each reachable basic block
+      if (PrintCounters)
+      {
+        errs() << "\n--- COUNTERS ---\n";
+        errs() << "Worklist iterations: " << blockVisits << "\n";
+        errs() << "Instruction evaluations: " << evaluations << "\n";
+      }
+    }
 
-        // If 'to' is placeholder, then value is constant number
-        if (to.at(i) == nullValue)
+    static Interval getFullInterval()
+    {
+      return Interval{std::numeric_limits<int>::min(), std::numeric_limits<int>::max()};
+    }
+
+    // Join of the states at the end of the predecessors, variables known in each of them
+    // Predecessor not evaluated yet: latch of the loop of BB (variables stored in the loop removed),
+    // every variable unknown otherwise (irreducible cycle)
+    MemoryState getEntryMemory(BasicBlock *BB, const SmallPtrSet<BasicBlock *, 32> &reachable, const DenseMap<BasicBlock *, MemoryState> &blockMemory,
+                               LoopInfo &loopInfo, DenseMap<Loop *, SmallPtrSet<AllocaInst *, 16>> &loopStores)
+    {
+      MemoryState memory;
+      bool isFirst = true;
+      Loop *headerLoop = nullptr;
+      for (BasicBlock *pred : predecessors(BB))
+      {
+        if (!reachable.count(pred))
         {
-          refValue1 = toValue.at(i);
+          continue;
         }
-
-        // If 'to2' is placeholder, then value is constant number
-        if (to2.at(i) == nullValue)
+        DenseMap<BasicBlock *, MemoryState>::const_iterator predIt = blockMemory.find(pred);
+        if (predIt == blockMemory.end())
         {
-          refValue2 = toValue.at(i);
+          Loop *L = loopInfo.getLoopFor(BB);
+          if (L == nullptr || L->getHeader() != BB || !L->contains(pred))
+          {
+            return MemoryState();
+          }
+          headerLoop = L;
+          continue;
         }
 
-        // Search variable reference inside already found ranges
-        for (unsigned v = 0; v < ranged.size(); ++v)
+        if (isFirst)
+        {
+          memory = predIt->second;
+          isFirst = false;
+          continue;
+        }
+        for (MemoryState::iterator varIt = memory.begin(); varIt != memory.end();)
         {
-          // When found value of 'to' in 'ranged'
-          if (to.at(i) == ranged.at(v))
+          MemoryState::const_iterator predVar = predIt->second.find(varIt->first);
+          MemoryState::iterator next = std::next(varIt);
+          if (predVar == predIt->second.end())
           {
-            // When range found, add a new found range
-            refValue1 = minRange.at(v);
+            memory.erase(varIt);
           }
-
-          // When found value of 'to2' in 'ranged'
-          if (to2.at(i) == ranged.at(v))
+          else
           {
-            // When range found, add a new found range
-            refValue2 = minRange.at(v);
+            varIt->second.minRange = std::min(varIt->second.minRange, predVar->second.minRange);
+            varIt->second.maxRange = std::max(varIt->second.maxRange, predVar->second.maxRange);
           }
+          varIt = next;
         }
+      }
 
-        // Compute found value-range from resolved dependencies
-        if (toOps.at(i) == Instruction::Add)
+      if (headerLoop != nullptr)
+      {
+        for (AllocaInst *allocaInst : loopStores[headerLoop])
         {
-          minRange.push_back(refValue1 + refValue2);
-          maxRange.push_back(refValue1 + refValue2);
-          ranged.push_back(from.at(i));
-          errs() << "  " << from.at(i)->getName() << " = " << refValue1 << " + " << refValue2 << " = " << (refValue1 + refValue2) << "\n\n";
+          NumWidenings += memory.erase(allocaInst);
         }
-        else if (toOps.at(i) == Instruction::Sub)
+      }
+      return memory;
+    }
+
+    // Constant or interval of an evaluated value, (-Inf, +Inf) when none was found
+    // Constants are signed in their own width (i8 255 is -1), (-Inf, +Inf) when they do not fit an int
+    Interval getInterval(Value *V, const DenseMap<Value *, Interval> &intervals)
+    {
+      if (ConstantInt *CI = dyn_cast<ConstantInt>(V))
+      {
+        if (CI->getValue().getMinSignedBits() > 32)
         {
-          minRange.push_back(refValue1 - refValue2);
-          maxRange.push_back(refValue1 - refValue2);
-          ranged.push_back(from.at(i));
-          errs() << "  " << from.at(i)->getName() << " = " << refValue1 << " - " << refValue2 << " = " << (refValue1 - refValue2) << "\n\n";
+          return getFullInterval();
         }
+        int value = int(CI->getSExtValue());
+        return Interval{value, value};
       }
+      DenseMap<Value *, Interval>::const_iterator found = intervals.find(V);
+      return found == intervals.end() ? getFullInterval() : found->second;
+    }
 
-      // Print value range computed
-      errs() << "\n--- VALUE RANGES ---\n";
-      for (unsigned i = 0; i < minRange.size(); ++i)
+    // Bounds computed in 64 bits, (-Inf, +Inf) when one of them is out of the signed range of the
+    // width of the value (it wraps) or does not fit an int (wider values)
+    Interval addSubOpe(const Interval &range0, const Interval &range1, bool isSub, unsigned width)
+    {
+      int64_t minRange = isSub ? int64_t(range0.minRange) - range1.maxRange : int64_t(range0.minRange) + range1.minRange;
+      int64_t maxRange = isSub ? int64_t(range0.maxRange) - range1.minRange : int64_t(range0.maxRange) + range1.maxRange;
+      unsigned boundWidth = std::min(width, 32u);
+      if (minRange < -(int64_t(1) << (boundWidth - 1)) || maxRange > (int64_t(1) << (boundWidth - 1)) - 1)
       {
-        errs() << " " << ranged.at(i)->getName() << "(" << minRange.at(i) << ", " << maxRange.at(i) << ")\n";
+        return getFullInterval();
       }
+      return Interval{int(minRange), int(maxRange)};
+    }
+
+    // New value-range of V, added to the report
+    void addRange(Value *V, const Interval &interval, std::vector<std::pair<Value *, Interval>> *ranged)
+    {
+      ranged->push_back(std::make_pair(V, interval));
+    }
+
+    // "(min, max)", -Inf/+Inf for the minimum/maximum int
+    std::string printInterval(const Interval &interval)
+    {
+      std::string valString = "(";
+      valString += interval.minRange == std::numeric_limits<int>::min() ? "-Inf" : std::to_string(interval.minRange);
+      valString += ", ";
+      valString += interval.maxRange == std::numeric_limits<int>::max() ? "+Inf" : std::to_string(interval.maxRange);
+      return valString + ")";
+    }
+  };
+
+  struct HppsConstantRange : public FunctionPass
+  {
+    static char ID;
+    HppsConstantRange() : FunctionPass(ID) {}
 
+    // Run over a single function (main)
+    bool runOnFunction(Function &Func) override
+    {
+      ConstantRangeSolver().run(Func);
       return false;
     }
-  }; // namespace
+  };
+
+  // New pass manager: print<const-range>
+  struct ConstantRangePrinterPass : public PassInfoMixin<ConstantRangePrinterPass>
+  {
+    PreservedAnalyses run(Function &Func, FunctionAnalysisManager &)
+    {
+      ConstantRangeSolver().run(Func);
+      return PreservedAnalyses::all();
+    }
+
+    // Also run on optnone functions (clang -O0 output)
+    static bool isRequired() { return true; }
+  };
 } // end of anonymous namespace
 
 char HppsConstantRange::ID = 0;
@@ -299,7 +447,24 @@ static RegisterPass<HppsConstantRange> X("const-range", "Constant Range Pass",
                             false /* Analysis Pass */);
 
 static RegisterStandardPasses Y(PassManagerBuilder::EP_EarlyAsPossible,
-                                [](const PassManagerBuilder &Builder,
+                                [](const PassManagerBuilder &,
                                    legacy::PassManagerBase &PM) {
                                   PM.add(new HppsConstantRange());
-                                });
\ No newline at end of file
+                                });
+
+// New pass manager: opt -load-pass-plugin=LLVMConstantRange.so -passes='print<const-range>'
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo()
+{
+  return {LLVM_PLUGIN_API_VERSION, "ConstantRange", LLVM_VERSION_STRING,
+          [](PassBuilder &PB) {
+            PB.registerPipelineParsingCallback(
+                [](StringRef Name, FunctionPassManager &FPM, ArrayRef<PassBuilder::PipelineElement>) {
+                  if (Name == "print<const-range>")
+                  {
+                    FPM.addPass(ConstantRangePrinterPass());
+                    return true;
+                  }
+                  return false;
+                });
+          }};
+}
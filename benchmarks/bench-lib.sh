@@ -0,0 +1,83 @@
+# Shared by the benchmark scripts (sourced), needs CLANG, OPT and BENCH_IR (BENCH_DIR and CC for build_measure)
+
+# Generate SSA IR once (pipeline of src/branch-range/example/README.md in the new pass manager form,
+# instsimplify in place of the removed -constprop)
+# Fails with a message when clang or opt cannot produce it, callers stop: ir=$(to_ir "$src") || exit 1
+to_ir()
+{
+    case "$1" in
+    *.ll)
+        echo "$1"
+        return
+        ;;
+    esac
+
+    ir="$BENCH_IR/$(basename "$1" .c).ll"
+    if [ ! -f "$ir" ] || [ "$1" -nt "$ir" ]; then
+        if ! "$CLANG" -c -O0 -w -emit-llvm "$1" -o "$ir.bc" -Xclang -disable-O0-optnone ||
+            ! "$OPT" -passes='mem2reg,instsimplify,dce,simplifycfg,gvn' -S "$ir.bc" -o "$ir"; then
+            rm -f "$ir.bc" "$ir"
+            echo "cannot generate the IR of $1" >&2
+            return 1
+        fi
+        rm -f "$ir.bc"
+    fi
+    echo "$ir"
+}
+
+# clang -O0 IR (variables in allocas) once, the input of const-range (fails like to_ir)
+to_o0_ir()
+{
+    case "$1" in
+    *.ll)
+        echo "$1"
+        return
+        ;;
+    esac
+
+    ir="$BENCH_IR/$(basename "$1" .c).o0.ll"
+    if [ ! -f "$ir" ] || [ "$1" -nt "$ir" ]; then
+        if ! "$CLANG" -S -O0 -w -emit-llvm "$1" -o "$ir"; then
+            rm -f "$ir"
+            echo "cannot generate the IR of $1" >&2
+            return 1
+        fi
+    fi
+    echo "$ir"
+}
+
+now_ns()
+{
+    date +%s%N
+}
+
+# Instructions of the defined functions of an IR file
+count_instructions()
+{
+    awk '/^define / { body = 1; next } /^}/ { body = 0 } body && /^  [^ ;]/ { ++count } END { print count + 0 }' "$1"
+}
+
+# Wall time and peak memory helper (measure.c), built into $BENCH_IR/measure
+build_measure()
+{
+    "$CC" -O2 "$BENCH_DIR/measure.c" -o "$BENCH_IR/measure"
+}
+
+# RUNS runs of a command with the measure helper, output of the last one in <log>
+# Prints "<average wall time in ns> <peak resident memory in KiB>", nothing when the command fails
+measure_runs()
+{
+    log=$1
+    shift
+    total=0
+    peak=0
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        "$BENCH_IR/measure" "$BENCH_IR/measure.run" "$@" >"$log" 2>&1 || return
+        read -r ns kib <"$BENCH_IR/measure.run"
+        total=$((total + ns))
+        [ "$kib" -gt "$peak" ] && peak=$kib
+        i=$((i + 1))
+    done
+    echo "$((total / RUNS)) $peak"
+}
@@ -0,0 +1,81 @@
+#!/bin/sh
+# Scaling of the const-range pass on generated straight-line functions (clang -O0 style: variables
+# in allocas, load/add/sub/store), average running time for each number of instructions
+#
+# Usage: const-range-bench.sh <LLVMConstantRange.so> [<instructions> ...]
+#   const-range-bench.sh build/lib/LLVMConstantRange.so 1000 10000 100000 (default sizes)
+#
+# Environment:
+#   LLVM_BIN  directory containing opt (default: from PATH)
+#   RUNS      number of runs averaged for each size (default: 3)
+#   BENCH_IR  directory receiving the generated functions (default: benchmarks/ir)
+#   VARS      number of variables of the generated functions (default: 16)
+
+if [ $# -lt 1 ]; then
+    sed -n '2,12p' "$0"
+    exit 1
+fi
+
+PLUGIN=$1
+shift
+SIZES=${*:-"1000 10000 100000"}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+OPT=${LLVM_BIN:+$LLVM_BIN/}opt
+RUNS=${RUNS:-3}
+BENCH_IR=${BENCH_IR:-$BENCH_DIR/ir}
+VARS=${VARS:-16}
+
+mkdir -p "$BENCH_IR"
+
+. "$BENCH_DIR/bench-lib.sh"
+
+# Function of about <instructions> instructions: the variables are initialized with constants, then
+# v = load a + load b (or a constant), the loads are unnamed like in the clang output
+generate()
+{
+    awk -v size="$1" -v vars="$VARS" 'BEGIN {
+        srand(1)
+        print "define i32 @straight() {"
+        print "entry:"
+        for (v = 0; v < vars; ++v)
+            printf "  %%v%d = alloca i32, align 4\n", v
+        for (v = 0; v < vars; ++v)
+            printf "  store i32 %d, i32* %%v%d, align 4\n", v, v
+        count = 2 * vars
+        tmp = 0
+        for (k = 0; count < size; ++k) {
+            op = rand() < 0.5 ? "add" : "sub"
+            printf "  %%%d = load i32, i32* %%v%d, align 4\n", tmp, int(rand() * vars)
+            lhs = tmp++
+            if (rand() < 0.5) {
+                rhs = int(rand() * 100)
+                count += 3
+            } else {
+                printf "  %%%d = load i32, i32* %%v%d, align 4\n", tmp, int(rand() * vars)
+                rhs = "%" tmp++
+                count += 4
+            }
+            printf "  %%%s%d = %s nsw i32 %%%d, %s\n", op, k, op, lhs, rhs
+            printf "  store i32 %%%s%d, i32* %%v%d, align 4\n", op, k, int(rand() * vars)
+        }
+        print "  ret i32 0"
+        print "}"
+    }'
+}
+
+printf "%-14s %14s\n" "instructions" "time"
+for size in $SIZES; do
+    ir=$BENCH_IR/straight-$size.ll
+    [ -f "$ir" ] || generate "$size" >"$ir"
+
+    start=$(now_ns)
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        "$OPT" -load-pass-plugin="$PLUGIN" -passes='print<const-range>' "$ir" -disable-output 2>/dev/null
+        i=$((i + 1))
+    done
+    end=$(now_ns)
+    printf "%-14s" "$size"
+    awk -v ns=$((end - start)) -v runs="$RUNS" 'BEGIN { printf " %12.3fms\n", ns / runs / 1000000 }'
+done
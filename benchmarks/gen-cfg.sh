@@ -0,0 +1,190 @@
+#!/bin/sh
+# Generator of large functions for the scaling of the passes: a sequence of regions, each one a nest
+# of <depth> counting loops whose innermost body is a chain of BODY blocks
+# - each loop header has <phis> phis: the induction variable (compared to a constant bound) and
+#   accumulators updated in the latch (acc = (acc + v) & 1023, v the value of the inner loop or chain)
+# - each body block computes OPS instructions from the value of the previous one, then ends with an
+#   if/else (compare, then/else blocks and a phi where they merge) for <density> percent of the blocks
+# Regions are added until the function has <blocks> basic blocks
+# FORM=o0 emits the same function like the clang -O0 output (input of const-range): the induction
+# variables, the accumulators and the value of the chain of each region are allocas, loaded before
+# each use and stored after each definition, without phis
+#
+# Usage: gen-cfg.sh <blocks> [<depth> [<phis> [<density>]]] > file.ll
+#   gen-cfg.sh 100000 2 3 50 (defaults: depth 2, phis 2, density 50)
+#
+# Environment:
+#   BODY  blocks of the innermost chain of each region (default: 8)
+#   OPS   instructions computed by each body block (default: 3)
+#   SEED  seed of the constants and of the branches (default: 1)
+#   FORM  ssa or o0 (default: ssa)
+
+if [ $# -lt 1 ]; then
+    sed -n '2,20p' "$0"
+    exit 1
+fi
+
+awk -v blocks="$1" -v depth="${2:-2}" -v phis="${3:-2}" -v density="${4:-50}" \
+    -v body="${BODY:-8}" -v ops="${OPS:-3}" -v seed="${SEED:-1}" -v form="${FORM:-ssa}" '
+function constant(max)
+{
+    return 1 + int(rand() * max)
+}
+
+# Instructions are buffered: the allocas of the o0 form go to the entry block
+function emit(line)
+{
+    lines[numLines++] = line
+}
+
+function variable(name)
+{
+    allocas[numAllocas++] = sprintf("  %%%s.addr = alloca i32, align 4", name)
+}
+
+# Value read by an instruction: v itself (ssa) or the load of variable v (o0), named name
+function use(v, name)
+{
+    if (!o0)
+        return v
+    emit(sprintf("  %%%s = load i32, i32* %%%s.addr, align 4", name, v))
+    return name
+}
+
+# name = op value, c, stored into variable "target" (o0)
+function compute(name, op, value, c, target)
+{
+    emit(sprintf("  %%%s = %s i32 %%%s, %s", name, op, value, c))
+    if (o0)
+        emit(sprintf("  store i32 %%%s, i32* %%%s.addr, align 4", name, target))
+}
+
+# Chain of body blocks of region r, from block "start" and value v, to block "target"; returns its
+# value (o0: the variable rN.c holding it)
+function chain(r, start, v, target,    k, b, t, op, c)
+{
+    emit(start ":")
+    c = "r" r ".c"
+    if (o0) {
+        variable(c)
+        compute(c ".init", "add nsw", use(v, c ".in"), 0, c)
+        v = c
+    }
+    for (k = 0; k < body; ++k) {
+        b = "r" r ".b" k
+        for (t = 0; t < ops; ++t) {
+            op = rand()
+            op = op < 0.4 ? "add nsw" : op < 0.7 ? "sub nsw" : "and"
+            compute(b ".o" t, op, use(v, b ".o" t ".in"), constant(op == "and" ? 4095 : 64), c)
+            if (!o0)
+                v = b ".o" t
+        }
+        ++count
+        if (rand() * 100 < density) {
+            emit(sprintf("  %%%s.cmp = icmp slt i32 %%%s, %d", b, use(v, b ".cmp.in"), constant(2048)))
+            emit(sprintf("  br i1 %%%s.cmp, label %%%s.then, label %%%s.else", b, b, b))
+            emit(b ".then:")
+            compute(b ".inc", "add nsw", use(v, b ".inc.in"), 1, c)
+            emit(sprintf("  br label %%%s.end", b))
+            emit(b ".else:")
+            compute(b ".dec", "sub nsw", use(v, b ".dec.in"), constant(1024), c)
+            emit(sprintf("  br label %%%s.end", b))
+            emit(b ".end:")
+            if (!o0) {
+                emit(sprintf("  %%%s.v = phi i32 [ %%%s.inc, %%%s.then ], [ %%%s.dec, %%%s.else ]", b, b, b, b, b))
+                v = b ".v"
+            }
+            count += 3
+        }
+        if (k + 1 < body) {
+            emit(sprintf("  br label %%r%d.b%d.ops", r, k + 1))
+            emit(sprintf("r%d.b%d.ops:", r, k + 1))
+        }
+    }
+    emit(sprintf("  br label %%%s", target))
+    return v
+}
+
+BEGIN {
+    srand(seed)
+    o0 = form == "o0"
+    count = 1
+    v = "x0"
+    if (o0) {
+        variable(v)
+        compute("x0.val", "and", "x", 1023, v)
+    } else {
+        compute(v, "and", "x", 1023)
+    }
+    emit("  br label %r0")
+
+    for (r = 0; count < blocks; ++r) {
+        start = "r" r
+        if (depth == 0) {
+            v = chain(r, start, v, "r" (r + 1))
+            continue
+        }
+
+        # Headers of the nest from the outermost, each one entered from a preheader (the region start
+        # for level 0) initializing its variables (o0), the false edge of level l leaves to the latch of l - 1
+        pred = start
+        emit(start ":")
+        ++count
+        for (l = 0; l < depth; ++l) {
+            h = "r" r ".l" l
+            if (o0) {
+                variable(h ".iv")
+                emit(sprintf("  store i32 0, i32* %%%s.iv.addr, align 4", h))
+                for (j = 1; j < phis; ++j) {
+                    variable(h ".acc" j)
+                    compute(h ".acc" j ".init", "add nsw", use(v, h ".acc" j ".in"), 0, h ".acc" j)
+                }
+            }
+            emit(sprintf("  br label %%%s.h", h))
+            emit(h ".h:")
+            if (o0) {
+                use(h ".iv", h ".iv")
+            } else {
+                emit(sprintf("  %%%s.iv = phi i32 [ 0, %%%s ], [ %%%s.iv.next, %%%s.latch ]", h, pred, h, h))
+                for (j = 1; j < phis; ++j)
+                    emit(sprintf("  %%%s.acc%d = phi i32 [ %%%s, %%%s ], [ %%%s.acc%d.next, %%%s.latch ]", h, j, v, pred, h, j, h))
+            }
+            emit(sprintf("  %%%s.cmp = icmp slt i32 %%%s.iv, %d", h, h, constant(100)))
+            exit_block = l == 0 ? "r" (r + 1) : "r" r ".l" (l - 1) ".latch"
+            inner = l + 1 < depth ? "r" r ".l" (l + 1) ".pre" : "r" r ".b0.ops"
+            emit(sprintf("  br i1 %%%s.cmp, label %%%s, label %%%s", h, inner, exit_block))
+            if (l + 1 < depth) {
+                emit(inner ":")
+                ++count
+            }
+            pred = inner
+            v = phis > 1 ? h ".acc1" : h ".iv"
+            count += 2
+        }
+        inner_v = chain(r, "r" r ".b0.ops", v, "r" r ".l" (depth - 1) ".latch")
+
+        # Latches from the innermost, accumulators of level l fed by the value of the chain
+        for (l = depth - 1; l >= 0; --l) {
+            h = "r" r ".l" l
+            emit(h ".latch:")
+            for (j = 1; j < phis; ++j) {
+                rhs = use(l == depth - 1 ? inner_v : "r" r ".l" (l + 1) ".acc1", h ".acc" j ".rhs")
+                emit(sprintf("  %%%s.acc%d.sum = add nsw i32 %%%s, %%%s", h, j, use(h ".acc" j, h ".acc" j ".cur"), rhs))
+                compute(h ".acc" j ".next", "and", h ".acc" j ".sum", 1023, h ".acc" j)
+            }
+            compute(h ".iv.next", "add nsw", use(h ".iv", h ".iv.cur"), 1, h ".iv")
+            emit(sprintf("  br label %%%s.h", h))
+        }
+        v = phis > 1 ? "r" r ".l0.acc1" : "r" r ".l0.iv"
+    }
+    emit(sprintf("r%d:", r))
+    emit(sprintf("  ret i32 %%%s", use(v, "result")))
+
+    print "define i32 @generated(i32 %x) {"
+    print "entry:"
+    for (i = 0; i < numAllocas; ++i)
+        print allocas[i]
+    for (i = 0; i < numLines; ++i)
+        print lines[i]
+    print "}"
+}'
@@ -0,0 +1,105 @@
+#!/bin/sh
+# Cost of the ranges after branch-range-strength: recomputed for the whole function or updated from the
+# rewritten block only (-branch-range-strength-incremental), on generated functions of <diamonds> if/else
+# blocks without loops: each if/else compares the value of the previous one (signed values, left
+# unchanged by the rewrite), an sdiv of the block at POSITION percent of the chain is rewritten into lshr
+# Times of opt (ms, best of RUNS runs): the analysis alone, then the rewrite followed by the ranges
+# (require<branch-range>) recomputed and updated
+#
+# Usage: incremental-bench.sh <LLVMBranchRange.so> [<diamonds> ...]
+#   incremental-bench.sh build/lib/LLVMBranchRange.so 100 500 1000 (default sizes)
+#
+# Environment:
+#   LLVM_BIN  directory containing opt (default: from PATH)
+#   RUNS      number of runs, the fastest is reported (default: 5)
+#   BENCH_IR  directory receiving the generated functions (default: benchmarks/ir)
+#   POSITION  position of the rewritten block in the chain, in percent (default: 90)
+#   FLAGS     options of the analysis, e.g. -branch-range-storage=map (default: none)
+
+if [ $# -lt 1 ]; then
+    sed -n '2,17p' "$0"
+    exit 1
+fi
+
+PLUGIN=$1
+shift
+SIZES=${*:-"100 500 1000"}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+OPT=${LLVM_BIN:+$LLVM_BIN/}opt
+RUNS=${RUNS:-5}
+BENCH_IR=${BENCH_IR:-$BENCH_DIR/ir}
+POSITION=${POSITION:-90}
+FLAGS=${FLAGS:-}
+
+mkdir -p "$BENCH_IR"
+
+. "$BENCH_DIR/bench-lib.sh"
+
+# v(k+1) = v(k) < c ? v(k) + 1 : v(k) - c - 128 (in [-128, 127]), v0 = (x & 255) - 128, q = (v(at) & 255) / 4, then table[v(n) + q]
+generate()
+{
+    awk -v size="$1" -v at="$2" 'BEGIN {
+        srand(1)
+        print "@table = global [512 x i32] zeroinitializer"
+        print ""
+        print "define i32 @chain(i32 %x) {"
+        print "entry:"
+        print "  %x8 = and i32 %x, 255"
+        print "  %v0 = sub nsw i32 %x8, 128"
+        print "  br label %if0"
+        for (k = 0; k < size; ++k) {
+            c = 1 + int(rand() * 127)
+            printf "if%d:\n", k
+            if (k == at)
+                printf "  %%w = and i32 %%v%d, 255\n  %%q = sdiv i32 %%w, 4\n", k
+            printf "  %%cmp%d = icmp slt i32 %%v%d, %d\n", k, k, c
+            printf "  br i1 %%cmp%d, label %%then%d, label %%else%d\n", k, k, k
+            printf "then%d:\n  %%inc%d = add nsw i32 %%v%d, 1\n  br label %%if%d.end\n", k, k, k, k
+            printf "else%d:\n  %%dec%d = sub nsw i32 %%v%d, %d\n  br label %%if%d.end\n", k, k, k, c + 128, k
+            printf "if%d.end:\n  %%v%d = phi i32 [ %%inc%d, %%then%d ], [ %%dec%d, %%else%d ]\n", k, k + 1, k, k, k, k
+            printf "  br label %%if%d\n", k + 1
+        }
+        printf "if%d:\n", size
+        printf "  %%sum = add nsw i32 %%v%d, %%q\n", size
+        print "  %idx = getelementptr inbounds [512 x i32], [512 x i32]* @table, i32 0, i32 %sum"
+        print "  %elem = load i32, i32* %idx, align 4"
+        print "  ret i32 %elem"
+        print "}"
+    }'
+}
+
+# Fastest of RUNS runs of opt -passes=<passes> <flags>, in ms
+best_time()
+{
+    passes=$1
+    shift
+    best=
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(now_ns)
+        # shellcheck disable=SC2086
+        if ! "$OPT" -load-pass-plugin="$PLUGIN" -load "$PLUGIN" -passes="$passes" $FLAGS "$@" "$ir" -disable-output >/dev/null 2>&1; then
+            printf "%14s" "failed"
+            return
+        fi
+        end=$(now_ns)
+        elapsed=$((end - start))
+        if [ -z "$best" ] || [ $elapsed -lt "$best" ]; then
+            best=$elapsed
+        fi
+        i=$((i + 1))
+    done
+    awk -v ns="$best" 'BEGIN { printf "%12.3fms", ns / 1000000 }'
+}
+
+printf "%-10s %14s %14s %14s\n" "diamonds" "analysis" "recomputed" "updated"
+for size in $SIZES; do
+    ir=$BENCH_IR/strength-chain-$size-$POSITION.ll
+    [ -f "$ir" ] || generate "$size" $((size * POSITION / 100)) >"$ir"
+
+    printf "%-10s" "$size"
+    printf " %s" "$(best_time 'require<branch-range>')"
+    printf " %s" "$(best_time 'branch-range-strength,require<branch-range>' -branch-range-strength-incremental=false)"
+    printf " %s\n" "$(best_time 'branch-range-strength,require<branch-range>' -branch-range-strength-incremental=true)"
+done
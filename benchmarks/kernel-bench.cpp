@@ -0,0 +1,207 @@
+// Per-operation cost of the interval kernels of BranchRangeKernels.h
+//
+//   apint:  GenericInterval, APInt bounds and ConstantRange arithmetic (any bit width)
+//   kernel: IntervalKernels, APInt bounds dispatched on the fixed-width kernels (what the pass runs)
+//   fixed:  FixedInterval<Width>, machine integer bounds, no conversion
+//
+// Every result of the kernels is checked against the APInt version before timing
+// Build and run with kernel-bench.sh
+
+#include "BranchRangeKernels.h"
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+namespace
+{
+    enum Operation
+    {
+        Join,
+        Meet,
+        Add,
+        AddNsw,
+        Sub,
+        SubNsw
+    };
+
+    const char *operationNames[] = {"join", "meet", "add", "add nsw", "sub", "sub nsw"};
+
+    APIntInterval applyGeneric(Operation op, const APIntInterval &range0, const APIntInterval &range1)
+    {
+        switch (op)
+        {
+        case Join:
+            return GenericInterval::join(range0, range1);
+        case Meet:
+            return GenericInterval::meet(range0, range1);
+        case Add:
+            return GenericInterval::binaryOp(Instruction::Add, range0, range1, 0);
+        case AddNsw:
+            return GenericInterval::binaryOp(Instruction::Add, range0, range1, OverflowingBinaryOperator::NoSignedWrap);
+        case Sub:
+            return GenericInterval::binaryOp(Instruction::Sub, range0, range1, 0);
+        default:
+            return GenericInterval::binaryOp(Instruction::Sub, range0, range1, OverflowingBinaryOperator::NoSignedWrap);
+        }
+    }
+
+    APIntInterval applyDispatched(Operation op, const APIntInterval &range0, const APIntInterval &range1)
+    {
+        switch (op)
+        {
+        case Join:
+            return IntervalKernels::join(range0, range1);
+        case Meet:
+            return IntervalKernels::meet(range0, range1);
+        case Add:
+            return IntervalKernels::binaryOp(Instruction::Add, range0, range1, 0);
+        case AddNsw:
+            return IntervalKernels::binaryOp(Instruction::Add, range0, range1, OverflowingBinaryOperator::NoSignedWrap);
+        case Sub:
+            return IntervalKernels::binaryOp(Instruction::Sub, range0, range1, 0);
+        default:
+            return IntervalKernels::binaryOp(Instruction::Sub, range0, range1, OverflowingBinaryOperator::NoSignedWrap);
+        }
+    }
+
+    template <unsigned Width>
+    FixedInterval<Width> applyFixed(Operation op, FixedInterval<Width> range0, FixedInterval<Width> range1)
+    {
+        switch (op)
+        {
+        case Join:
+            return FixedInterval<Width>::join(range0, range1);
+        case Meet:
+            return FixedInterval<Width>::meet(range0, range1);
+        case Add:
+            return FixedInterval<Width>::addSub(range0, range1, false, false);
+        case AddNsw:
+            return FixedInterval<Width>::addSub(range0, range1, false, true);
+        case Sub:
+            return FixedInterval<Width>::addSub(range0, range1, true, false);
+        default:
+            return FixedInterval<Width>::addSub(range0, range1, true, true);
+        }
+    }
+
+    // Intervals like the ones of the fixpoint: small constants, loop counters, -Inf/+Inf bounds, empty
+    APIntInterval randomInterval(unsigned width, std::mt19937_64 &rng)
+    {
+        APInt min = APInt::getSignedMinValue(width);
+        APInt max = APInt::getSignedMaxValue(width);
+        switch (rng() % 8)
+        {
+        case 0:
+            return APIntInterval(max, min);
+        case 1:
+            return APIntInterval(min, max);
+        case 2:
+            return APIntInterval(min, APInt(width, rng(), true).ashr(1));
+        case 3:
+            return APIntInterval(APInt(width, rng(), true).ashr(1), max);
+        case 4:
+        case 5:
+        {
+            APInt low(width, int64_t(rng() % 256) - 128, true);
+            APInt high(width, int64_t(rng() % 256) - 128, true);
+            return low.sle(high) ? APIntInterval(low, high) : APIntInterval(high, low);
+        }
+        default:
+        {
+            APInt low(width, rng(), true);
+            APInt high(width, rng(), true);
+            return low.sle(high) ? APIntInterval(low, high) : APIntInterval(high, low);
+        }
+        }
+    }
+
+    template <typename Func>
+    double nanosecondsPerOperation(unsigned rounds, size_t operations, Func func)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned round = 0; round < rounds; ++round)
+        {
+            func();
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / (double(rounds) * operations);
+    }
+
+    template <unsigned Width>
+    void benchWidth(unsigned pairs, unsigned rounds, std::mt19937_64 &rng)
+    {
+        std::vector<APIntInterval> ranges0, ranges1;
+        std::vector<FixedInterval<Width>> fixed0, fixed1;
+        for (unsigned i = 0; i < pairs; ++i)
+        {
+            ranges0.push_back(randomInterval(Width, rng));
+            ranges1.push_back(randomInterval(Width, rng));
+            fixed0.push_back(FixedInterval<Width>::fromAPInt(ranges0.back()));
+            fixed1.push_back(FixedInterval<Width>::fromAPInt(ranges1.back()));
+        }
+
+        for (unsigned opIndex = Join; opIndex <= SubNsw; ++opIndex)
+        {
+            Operation op = static_cast<Operation>(opIndex);
+            for (unsigned i = 0; i < pairs; ++i)
+            {
+                APIntInterval expected = applyGeneric(op, ranges0[i], ranges1[i]);
+                APIntInterval dispatched = applyDispatched(op, ranges0[i], ranges1[i]);
+                APIntInterval fixed = applyFixed<Width>(op, fixed0[i], fixed1[i]).toAPInt();
+                if (dispatched != expected || fixed != expected)
+                {
+                    errs() << "i" << Width << " " << operationNames[op] << ": (" << ranges0[i].first << ", " << ranges0[i].second << ") ("
+                           << ranges1[i].first << ", " << ranges1[i].second << ") gives (" << fixed.first << ", " << fixed.second
+                           << "), expected (" << expected.first << ", " << expected.second << ")\n";
+                    exit(1);
+                }
+            }
+
+            // Sum of the bounds, keeps the results alive
+            int64_t checksum = 0;
+            double apintTime = nanosecondsPerOperation(rounds, pairs, [&]() {
+                for (unsigned i = 0; i < pairs; ++i)
+                {
+                    checksum += applyGeneric(op, ranges0[i], ranges1[i]).first.getSExtValue();
+                }
+            });
+            double kernelTime = nanosecondsPerOperation(rounds, pairs, [&]() {
+                for (unsigned i = 0; i < pairs; ++i)
+                {
+                    checksum += applyDispatched(op, ranges0[i], ranges1[i]).first.getSExtValue();
+                }
+            });
+            double fixedTime = nanosecondsPerOperation(rounds, pairs, [&]() {
+                for (unsigned i = 0; i < pairs; ++i)
+                {
+                    checksum += applyFixed<Width>(op, fixed0[i], fixed1[i]).min;
+                }
+            });
+
+            outs() << format("i%-4u %-10s %10.2f %10.2f %10.2f %9.1fx %9.1fx   (%lld)\n", Width, operationNames[op], apintTime, kernelTime,
+                             fixedTime, apintTime / kernelTime, apintTime / fixedTime, (long long)checksum);
+        }
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned pairs = argc > 1 ? unsigned(atoi(argv[1])) : 4096;
+    unsigned rounds = argc > 2 ? unsigned(atoi(argv[2])) : 200;
+    std::mt19937_64 rng(42);
+
+    outs() << "width operation    apint ns  kernel ns   fixed ns     kernel      fixed   (checksum)\n";
+    benchWidth<1>(pairs, rounds, rng);
+    benchWidth<8>(pairs, rounds, rng);
+    benchWidth<16>(pairs, rounds, rng);
+    benchWidth<32>(pairs, rounds, rng);
+    benchWidth<64>(pairs, rounds, rng);
+    return 0;
+}
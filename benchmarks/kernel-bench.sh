@@ -0,0 +1,21 @@
+#!/bin/sh
+# Per-operation cost of the fixed-width interval kernels against the APInt version (ns per operation)
+#
+# Usage: kernel-bench.sh [<interval pairs> [<rounds>]]
+#
+# Environment:
+#   LLVM_BIN  directory containing llvm-config (default: from PATH)
+#   CXX       C++ compiler (default: c++)
+#   BUILD_DIR directory receiving the kernel-bench binary (default: benchmarks/ir)
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+LLVM_CONFIG=${LLVM_BIN:+$LLVM_BIN/}llvm-config
+CXX=${CXX:-c++}
+BUILD_DIR=${BUILD_DIR:-$BENCH_DIR/ir}
+
+mkdir -p "$BUILD_DIR"
+
+$CXX -O2 $($LLVM_CONFIG --cxxflags) -I"$BENCH_DIR/.." "$BENCH_DIR/kernel-bench.cpp" -o "$BUILD_DIR/kernel-bench" \
+    $($LLVM_CONFIG --ldflags --libs core support) $($LLVM_CONFIG --system-libs) || exit 1
+
+"$BUILD_DIR/kernel-bench" "$@"
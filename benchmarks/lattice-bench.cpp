@@ -0,0 +1,213 @@
+// Cost of the operations of the interval domain (IntervalLattice of BranchRangeLattice.h) on their own,
+// without opt: nanoseconds and heap allocations for each operation, on random intervals like the ones
+// of the fixpoint, for the fixed-width kernels (i8, i32, i64) and the APInt path (i128)
+// Build and run with lattice-bench.sh
+
+#include "BranchRangeLattice.h"
+
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace llvm;
+
+// Heap allocations of the process, counted by the replaced global operator new
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size)
+{
+    ++allocations;
+    void *ptr = std::malloc(size ? size : 1);
+    // LLVM is built without exceptions: out of memory ends the bench
+    if (!ptr)
+    {
+        std::abort();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+    typedef IntervalLattice::Range Range;
+
+    // Inputs of an operation: two intervals, a compared constant and a predicate
+    struct Input
+    {
+        Range range0;
+        Range range1;
+        APInt cmpValue;
+        CmpInst::Predicate pred;
+    };
+
+    // Intervals like the ones of the fixpoint: small constants, loop counters, -Inf/+Inf bounds, empty
+    Range randomInterval(unsigned width, std::mt19937_64 &rng)
+    {
+        APInt min = APInt::getSignedMinValue(width);
+        APInt max = APInt::getSignedMaxValue(width);
+        switch (rng() % 8)
+        {
+        case 0:
+            return IntervalLattice::empty(width);
+        case 1:
+            return IntervalLattice::full(width);
+        case 2:
+            return Range(min, APInt(width, rng(), true).ashr(1));
+        case 3:
+            return Range(APInt(width, rng(), true).ashr(1), max);
+        case 4:
+        case 5:
+        {
+            APInt low(width, int64_t(rng() % 256) - 128, true);
+            APInt high(width, int64_t(rng() % 256) - 128, true);
+            return low.sle(high) ? Range(low, high) : Range(high, low);
+        }
+        default:
+        {
+            APInt low(width, rng(), true);
+            APInt high(width, rng(), true);
+            return low.sle(high) ? Range(low, high) : Range(high, low);
+        }
+        }
+    }
+
+    struct Result
+    {
+        double nanoseconds;
+        double allocations;
+    };
+
+    // Cost of one call of op for each input, over rounds rounds
+    template <typename Func>
+    Result measure(unsigned rounds, const std::vector<Input> &inputs, Func op)
+    {
+        // Sum of the results, keeps them alive
+        uint64_t checksum = 0;
+        uint64_t startAllocations = allocations;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (unsigned round = 0; round < rounds; ++round)
+        {
+            for (const Input &input : inputs)
+            {
+                checksum += op(input);
+            }
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        double operations = double(rounds) * inputs.size();
+        if (checksum == 42)
+        {
+            outs() << "";
+        }
+        return Result{elapsed.count() / operations, (allocations - startAllocations) / operations};
+    }
+
+    uint64_t lowBits(const Range &range)
+    {
+        return range.first.getLoBits(64).getZExtValue() ^ range.second.getLoBits(64).getZExtValue();
+    }
+
+    void benchWidth(unsigned width, unsigned count, unsigned rounds, std::mt19937_64 &rng)
+    {
+        static const CmpInst::Predicate predicates[] = {CmpInst::ICMP_EQ, CmpInst::ICMP_NE, CmpInst::ICMP_SLT, CmpInst::ICMP_SLE, CmpInst::ICMP_SGT,
+                                                        CmpInst::ICMP_SGE, CmpInst::ICMP_ULT, CmpInst::ICMP_ULE, CmpInst::ICMP_UGT, CmpInst::ICMP_UGE};
+        std::vector<Input> inputs;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            inputs.push_back(Input{randomInterval(width, rng), randomInterval(width, rng), APInt(width, int64_t(rng() % 512) - 256, true),
+                                   predicates[rng() % 10]});
+        }
+
+        // Thresholds of a function with 16 compared constants (+1 and -1 each), sorted signed
+        std::vector<APInt> thresholds;
+        for (unsigned i = 0; i < 16; ++i)
+        {
+            APInt constant(width, int64_t(rng() % 512) - 256, true);
+            thresholds.push_back(constant - 1);
+            thresholds.push_back(constant);
+            thresholds.push_back(constant + 1);
+        }
+        std::sort(thresholds.begin(), thresholds.end(), [](const APInt &lhs, const APInt &rhs) { return lhs.slt(rhs); });
+
+        struct Operation
+        {
+            const char *name;
+            Result result;
+        };
+        Operation operations[] = {
+            {"join", measure(rounds, inputs, [](const Input &input) { return lowBits(IntervalLattice::join(input.range0, input.range1)); })},
+            {"meet", measure(rounds, inputs, [](const Input &input) { return lowBits(IntervalLattice::meet(input.range0, input.range1)); })},
+            {"phi", measure(rounds, inputs, [](const Input &input) { return lowBits(IntervalLattice::phi(input.range0, input.range1)); })},
+            {"branch", measure(rounds, inputs, [](const Input &input) { return lowBits(IntervalLattice::branch(input.range0, input.range1)); })},
+            {"widen", measure(rounds, inputs, [&](const Input &input) { return lowBits(IntervalLattice::widen(input.range0, input.range1, thresholds)); })},
+            {"add", measure(rounds, inputs, [](const Input &input) {
+                 return lowBits(IntervalLattice::binaryOp(Instruction::Add, input.range0, input.range1, 0));
+             })},
+            {"add nsw", measure(rounds, inputs, [](const Input &input) {
+                 return lowBits(IntervalLattice::binaryOp(Instruction::Add, input.range0, input.range1, OverflowingBinaryOperator::NoSignedWrap));
+             })},
+            {"mul", measure(rounds, inputs, [](const Input &input) {
+                 return lowBits(IntervalLattice::binaryOp(Instruction::Mul, input.range0, input.range1, 0));
+             })},
+            {"and", measure(rounds, inputs, [](const Input &input) {
+                 return lowBits(IntervalLattice::binaryOp(Instruction::And, input.range0, input.range1, 0));
+             })},
+            {"compare", measure(rounds, inputs, [](const Input &input) {
+                 Range rangeTrue, rangeFalse;
+                 IntervalLattice::compareRegions(input.pred, input.cmpValue, &rangeTrue, &rangeFalse);
+                 return lowBits(rangeTrue) ^ lowBits(rangeFalse);
+             })},
+            {"toString", measure(rounds, inputs, [](const Input &input) { return uint64_t(IntervalLattice::toString(input.range0).size()); })},
+        };
+
+        for (const Operation &operation : operations)
+        {
+            outs() << format("i%-4u %-10s %10.2f %12.2f\n", width, operation.name, operation.result.nanoseconds, operation.result.allocations);
+        }
+    }
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned count = argc > 1 ? unsigned(atoi(argv[1])) : 4096;
+    unsigned rounds = argc > 2 ? unsigned(atoi(argv[2])) : 100;
+    std::mt19937_64 rng(42);
+
+    outs() << "width operation       ns/op    allocs/op\n";
+    for (unsigned width : {8, 32, 64, 128})
+    {
+        benchWidth(width, count, rounds, rng);
+    }
+    return 0;
+}
@@ -0,0 +1,22 @@
+#!/bin/sh
+# Cost of each operation of the interval domain (BranchRangeLattice.h) without opt: nanoseconds and
+# heap allocations for each operation on random intervals, for i8, i32, i64 and i128
+#
+# Usage: lattice-bench.sh [<inputs> [<rounds>]]
+#
+# Environment:
+#   LLVM_BIN  directory containing llvm-config (default: from PATH)
+#   CXX       C++ compiler (default: c++)
+#   BUILD_DIR directory receiving the lattice-bench binary (default: benchmarks/ir)
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+LLVM_CONFIG=${LLVM_BIN:+$LLVM_BIN/}llvm-config
+CXX=${CXX:-c++}
+BUILD_DIR=${BUILD_DIR:-$BENCH_DIR/ir}
+
+mkdir -p "$BUILD_DIR"
+
+$CXX -O2 $($LLVM_CONFIG --cxxflags) -I"$BENCH_DIR/.." "$BENCH_DIR/lattice-bench.cpp" "$BENCH_DIR/../BranchRangeLattice.cpp" \
+    -o "$BUILD_DIR/lattice-bench" $($LLVM_CONFIG --ldflags --libs core support) $($LLVM_CONFIG --system-libs) || exit 1
+
+"$BUILD_DIR/lattice-bench" "$@"
@@ -0,0 +1,96 @@
+#!/bin/sh
+# Speed of the code generated with and without the loop metadata of branch-range-loop-metadata
+# (ms for CALLS calls of fun() of each example, best of RUNS runs), or with and without another
+# transform of the ranges (TRANSFORM)
+#
+# Usage: loop-metadata-bench.sh <LLVMBranchRange.so> [<pipeline>]
+#   pipeline: new pass manager pipeline run after the metadata (default: default<O2>)
+#   loop-metadata-bench.sh ../build/lib/LLVMBranchRange.so 'function(sroa,loop-mssa(loop-rotate),loop-unroll)'
+#
+# Environment:
+#   LLVM_BIN  directory containing clang, opt and llc (default: from PATH)
+#   CC        C compiler linking the driver calling fun() (default: cc)
+#   CALLS     number of calls of fun() (default: 10000000)
+#   RUNS      number of runs, the fastest is reported (default: 5)
+#   BENCH_IR  directory where the generated IR and binaries are cached (default: benchmarks/ir)
+#   SOURCES   space separated list of .c/.ll inputs defining int fun(void)
+#             (default: the for-loop and nested-loop examples)
+#   TRANSFORM function pass run before the pipeline (default: branch-range-loop-metadata,
+#             e.g. branch-range-annotate, branch-range-bounds-check)
+
+if [ $# -lt 1 ]; then
+    sed -n '2,19p' "$0"
+    exit 1
+fi
+
+PLUGIN=$1
+PIPELINE=${2:-"default<O2>"}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+EXAMPLE_DIR=$BENCH_DIR/../src/branch-range/example
+CLANG=${LLVM_BIN:+$LLVM_BIN/}clang
+OPT=${LLVM_BIN:+$LLVM_BIN/}opt
+LLC=${LLVM_BIN:+$LLVM_BIN/}llc
+CC=${CC:-cc}
+CALLS=${CALLS:-10000000}
+RUNS=${RUNS:-5}
+BENCH_IR=${BENCH_IR:-$BENCH_DIR/ir}
+TRANSFORM=${TRANSFORM:-branch-range-loop-metadata}
+SOURCES=${SOURCES:-$(ls "$EXAMPLE_DIR"/for-loop/*.c "$EXAMPLE_DIR"/nested-loop/*.c)}
+
+mkdir -p "$BENCH_IR"
+
+. "$BENCH_DIR/bench-lib.sh"
+
+driver=$BENCH_IR/loop-metadata-driver.c
+cat >"$driver" <<EOF
+int fun(void);
+int main(void)
+{
+    volatile int sink;
+    for (long i = 0; i < $CALLS; ++i)
+        sink = fun();
+    return 0;
+}
+EOF
+
+# Binary of ir optimized with <passes>, into <exe>
+build()
+{
+    "$OPT" -load-pass-plugin="$PLUGIN" -passes="$2" "$1" -o "$3.bc" 2>/dev/null &&
+        "$LLC" -O2 -filetype=obj "$3.bc" -o "$3.o" &&
+        "$CC" -O2 "$driver" "$3.o" -o "$3"
+}
+
+# Fastest of RUNS runs of exe, in ms
+best_time()
+{
+    best=
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        start=$(now_ns)
+        "$1"
+        end=$(now_ns)
+        elapsed=$((end - start))
+        if [ -z "$best" ] || [ $elapsed -lt "$best" ]; then
+            best=$elapsed
+        fi
+        i=$((i + 1))
+    done
+    awk -v ns="$best" 'BEGIN { printf "%12.3fms", ns / 1000000 }'
+}
+
+printf "%-24s %14s %14s\n" "file" "base" "${TRANSFORM#branch-range-}"
+for src in $SOURCES; do
+    ir=$(to_ir "$src") || exit 1
+
+    name=$BENCH_IR/$(basename "$ir" .ll)
+    if ! build "$ir" "$PIPELINE" "$name.base" || ! build "$ir" "function($TRANSFORM),$PIPELINE" "$name.$TRANSFORM"; then
+        echo "cannot build $src" >&2
+        continue
+    fi
+
+    printf "%-24s" "$(basename "$src")"
+    printf " %s" "$(best_time "$name.base")"
+    printf " %s\n" "$(best_time "$name.$TRANSFORM")"
+done
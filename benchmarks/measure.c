@@ -0,0 +1,57 @@
+/*
+ * Wall time and peak resident memory of a command (used by throughput-bench.sh)
+ *
+ * Usage: measure <report> <command> [<arguments> ...]
+ *   runs the command, then writes "<wall time in ns> <peak resident memory in KiB>" into <report>
+ *   and exits with the status of the command
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+int main(int argc, char **argv)
+{
+    struct timespec start, end;
+    struct rusage usage;
+    FILE *report;
+    pid_t pid;
+    int status;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <report> <command> [<arguments> ...]\n", argv[0]);
+        return 2;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid = fork();
+    if (pid == 0)
+    {
+        execvp(argv[2], argv + 2);
+        perror(argv[2]);
+        _exit(127);
+    }
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0)
+    {
+        perror("measure");
+        return 2;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    report = fopen(argv[1], "w");
+    if (report == NULL)
+    {
+        perror(argv[1]);
+        return 2;
+    }
+    /* ru_maxrss is in KiB on Linux */
+    fprintf(report, "%lld %ld\n", (long long)(end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec), usage.ru_maxrss);
+    fclose(report);
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
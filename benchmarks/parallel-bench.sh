@@ -0,0 +1,59 @@
+#!/bin/sh
+# Scaling of the module driver: every benchmark linked into a single module, analyzed with 1, 2, 4 and 8 threads
+#
+# Usage: parallel-bench.sh <LLVMBranchRange.so> [<threads> ...]
+#   parallel-bench.sh ../build/lib/LLVMBranchRange.so 1 2 4 8 16
+#
+# Environment: same as run-bench.sh (LLVM_BIN, RUNS, BENCH_IR, SOURCES, OPT_FLAGS, TRACE_LOG)
+#   The linked module is $BENCH_IR/benchmarks-module.ll
+
+if [ $# -lt 1 ]; then
+    sed -n '2,8p' "$0"
+    exit 1
+fi
+
+PLUGIN=$1
+shift
+THREADS=${*:-1 2 4 8}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+CLANG=${LLVM_BIN:+$LLVM_BIN/}clang
+OPT=${LLVM_BIN:+$LLVM_BIN/}opt
+LINK=${LLVM_BIN:+$LLVM_BIN/}llvm-link
+BENCH_IR=${BENCH_IR:-$BENCH_DIR/ir}
+SOURCES=${SOURCES:-$(ls "$BENCH_DIR"/*.c "$BENCH_DIR"/bitwise/*/*.c)}
+
+mkdir -p "$BENCH_IR"
+
+. "$BENCH_DIR/bench-lib.sh"
+
+# Every benchmark defines main (and some the same helpers): suffix the symbols defined in $1 with $2
+rename_symbols()
+{
+    prog=$(sed -n -e 's/^define [^@]*@\([A-Za-z0-9_.$]*\)(.*/\1/p' -e 's/^@\([A-Za-z0-9_.$]*\) = .*/\1/p' "$1" |
+        sed -e 's/[.$]/\\&/g' -e "s/.*/s\/@&\\\\([^A-Za-z0-9_.\$]\\\\)\/@&.$2\\\\1\/g/")
+    sed -e "$prog" "$1"
+}
+
+MODULE="$BENCH_IR/benchmarks-module.ll"
+RENAMED="$BENCH_IR/renamed"
+rm -rf "$RENAMED"
+mkdir -p "$RENAMED"
+
+n=0
+for src in $SOURCES; do
+    ir=$(to_ir "$src") || exit 1
+    n=$((n + 1))
+    rename_symbols "$ir" "b$n" >"$RENAMED/$n.ll"
+done
+"$LINK" -S "$RENAMED"/*.ll -o "$MODULE" || exit 1
+rm -rf "$RENAMED"
+
+echo "$(grep -c '^define' "$MODULE") functions from $n files"
+configs=
+for t in $THREADS; do
+    configs="$configs t$t=-branch-range-threads=$t"
+done
+
+# shellcheck disable=SC2086
+SOURCES=$MODULE PASS=branch-range-module "$BENCH_DIR/run-bench.sh" "$PLUGIN" $configs
@@ -0,0 +1,90 @@
+#!/bin/sh
+# Latency of the demand-driven queries (print<branch-range-query>) against the fixpoint of the whole
+# function (BranchRangeAnalysis), on generated functions of <diamonds> if/else blocks without loops:
+# each if/else compares the value of the previous one, the last one indexes an array
+# Times of -time-passes (ms, best of RUNS runs): fixpoint, the last index only, every compared value
+#
+# Usage: query-bench.sh <LLVMBranchRange.so> [<diamonds> ...]
+#   query-bench.sh build/lib/LLVMBranchRange.so 100 1000 5000 (default sizes)
+#
+# Environment:
+#   LLVM_BIN  directory containing opt (default: from PATH)
+#   RUNS      number of runs, the fastest is reported (default: 5)
+#   BENCH_IR  directory receiving the generated functions (default: benchmarks/ir)
+
+if [ $# -lt 1 ]; then
+    sed -n '2,13p' "$0"
+    exit 1
+fi
+
+PLUGIN=$1
+shift
+SIZES=${*:-"100 1000 5000"}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+OPT=${LLVM_BIN:+$LLVM_BIN/}opt
+RUNS=${RUNS:-5}
+BENCH_IR=${BENCH_IR:-$BENCH_DIR/ir}
+
+mkdir -p "$BENCH_IR"
+
+# v(k+1) = v(k) < c ? v(k) + 1 : v(k) - c, v0 = x & 255, then table[v(n)]
+generate()
+{
+    awk -v size="$1" 'BEGIN {
+        srand(1)
+        print "@table = global [512 x i32] zeroinitializer"
+        print ""
+        print "define i32 @chain(i32 %x) {"
+        print "entry:"
+        print "  %v0 = and i32 %x, 255"
+        print "  br label %if0"
+        for (k = 0; k < size; ++k) {
+            c = 1 + int(rand() * 255)
+            printf "if%d:\n  %%cmp%d = icmp slt i32 %%v%d, %d\n", k, k, k, c
+            printf "  br i1 %%cmp%d, label %%then%d, label %%else%d\n", k, k, k
+            printf "then%d:\n  %%inc%d = add nsw i32 %%v%d, 1\n  br label %%if%d.end\n", k, k, k, k
+            printf "else%d:\n  %%dec%d = sub nsw i32 %%v%d, %d\n  br label %%if%d.end\n", k, k, k, c, k
+            printf "if%d.end:\n  %%v%d = phi i32 [ %%inc%d, %%then%d ], [ %%dec%d, %%else%d ]\n", k, k + 1, k, k, k, k
+            printf "  br label %%if%d\n", k + 1
+        }
+        printf "if%d:\n", size
+        printf "  %%idx = getelementptr inbounds [512 x i32], [512 x i32]* @table, i32 0, i32 %%v%d\n", size
+        print "  %elem = load i32, i32* %idx, align 4"
+        print "  ret i32 %elem"
+        print "}"
+    }'
+}
+
+# Fastest wall time of <row> in the -time-passes report of opt -passes=<passes> <flags>, in ms
+best_time()
+{
+    row=$1
+    passes=$2
+    shift 2
+    best=
+    i=0
+    while [ $i -lt "$RUNS" ]; do
+        # shellcheck disable=SC2086
+        t=$("$OPT" -load-pass-plugin="$PLUGIN" -load "$PLUGIN" -passes="$passes" -time-passes "$@" "$ir" -disable-output 2>&1 |
+            sed -n "s/.*  \([0-9.]*\) ( *[0-9.]*%)  $row\$/\1/p")
+        if [ -z "$t" ]; then
+            printf "%14s" "failed"
+            return
+        fi
+        best=$(awk -v t="$t" -v best="$best" 'BEGIN { print (best == "" || t < best) ? t : best }')
+        i=$((i + 1))
+    done
+    awk -v s="$best" 'BEGIN { printf "%12.3fms", s * 1000 }'
+}
+
+printf "%-10s %14s %14s %14s\n" "diamonds" "fixpoint" "one query" "every value"
+for size in $SIZES; do
+    ir=$BENCH_IR/chain-$size.ll
+    [ -f "$ir" ] || generate "$size" >"$ir"
+
+    printf "%-10s" "$size"
+    printf " %s" "$(best_time BranchRangeAnalysis 'require<branch-range>')"
+    printf " %s" "$(best_time BranchRangeQueryPrinterPass 'print<branch-range-query>' -branch-range-query-values="v$size")"
+    printf " %s\n" "$(best_time BranchRangeQueryPrinterPass 'print<branch-range-query>')"
+done
@@ -0,0 +1,69 @@
+#!/bin/sh
+# Time the branch-range pass over the benchmark sources with different options
+#
+# Usage: run-bench.sh <LLVMBranchRange.so> <label>=<opt flags> [<label>=<opt flags> ...]
+#   run-bench.sh ../build/lib/LLVMBranchRange.so map=-branch-range-storage=map dense=-branch-range-storage=dense
+#
+# Environment:
+#   LLVM_BIN  directory containing clang and opt (default: from PATH)
+#   RUNS      number of runs averaged for each file and configuration (default: 5)
+#   BENCH_IR  directory where the generated IR is cached (default: benchmarks/ir)
+#   SOURCES   space separated list of .c/.ll inputs (default: every benchmark source)
+#   OPT_FLAGS extra flags for every opt run (e.g. -enable-new-pm=0 on newer LLVM)
+#   TRACE_LOG file receiving the output of the pass (default: /dev/null)
+#   PASS      legacy pass that is timed (default: branch-range)
+
+if [ $# -lt 2 ]; then
+    sed -n '2,15p' "$0"
+    exit 1
+fi
+
+PLUGIN=$1
+shift
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+CLANG=${LLVM_BIN:+$LLVM_BIN/}clang
+OPT=${LLVM_BIN:+$LLVM_BIN/}opt
+RUNS=${RUNS:-5}
+TRACE_LOG=${TRACE_LOG:-/dev/null}
+PASS=${PASS:-branch-range}
+BENCH_IR=${BENCH_IR:-$BENCH_DIR/ir}
+SOURCES=${SOURCES:-$(ls "$BENCH_DIR"/*.c "$BENCH_DIR"/bitwise/*/*.c)}
+
+mkdir -p "$BENCH_IR"
+
+. "$BENCH_DIR/bench-lib.sh"
+
+printf "%-24s" "file"
+for config in "$@"; do
+    printf " %14s" "${config%%=*}"
+done
+printf "\n"
+
+for src in $SOURCES; do
+    ir=$(to_ir "$src") || exit 1
+
+    printf "%-24s" "$(basename "$src")"
+    for config in "$@"; do
+        flags=${config#*=}
+        failed=
+        start=$(now_ns)
+        i=0
+        while [ $i -lt "$RUNS" ]; do
+            # shellcheck disable=SC2086
+            if ! "$OPT" $OPT_FLAGS -load "$PLUGIN" -"$PASS" $flags "$ir" -o /dev/null 2>"$TRACE_LOG"; then
+                failed=1
+                break
+            fi
+            i=$((i + 1))
+        done
+        end=$(now_ns)
+        # A configuration opt rejects (e.g. -debug-only without assertions) is not timed
+        if [ -n "$failed" ]; then
+            printf " %14s" "failed"
+            continue
+        fi
+        awk -v ns=$((end - start)) -v runs="$RUNS" 'BEGIN { printf " %12.3fms", ns / runs / 1000000 }'
+    done
+    printf "\n"
+done
@@ -0,0 +1,96 @@
+#!/bin/sh
+# Scaling of both passes on the large functions of gen-cfg.sh: average wall time and peak resident
+# memory of opt for each number of basic blocks, printed, written to a CSV file and plotted with
+# gnuplot when it is installed. branch-range runs on the SSA form, const-range on the -O0 form of the
+# same function (FORM=o0)
+#
+# Usage: scaling-bench.sh <LLVMBranchRange.so> <LLVMConstantRange.so> [<blocks> ...]
+#   scaling-bench.sh build/lib/LLVMBranchRange.so build/lib/LLVMConstantRange.so 1000 10000 100000 (default sizes)
+#
+# Environment:
+#   LLVM_BIN  directory containing opt (default: from PATH)
+#   CC        C compiler building the measure helper (default: cc)
+#   RUNS      number of runs averaged for each size and pass (default: 3)
+#   BENCH_IR  directory receiving the generated functions, the CSV file and the plot (default: benchmarks/ir)
+#   DEPTH, PHIS, DENSITY  loop depth, phis per loop header, percent of if/else blocks (see gen-cfg.sh)
+#   FLAGS     options of branch-range, e.g. -branch-range-storage=map (default: none)
+
+if [ $# -lt 2 ]; then
+    sed -n '2,16p' "$0"
+    exit 1
+fi
+
+BRANCH_PLUGIN=$1
+CONST_PLUGIN=$2
+shift 2
+SIZES=${*:-"1000 10000 100000"}
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+OPT=${LLVM_BIN:+$LLVM_BIN/}opt
+CC=${CC:-cc}
+RUNS=${RUNS:-3}
+BENCH_IR=${BENCH_IR:-$BENCH_DIR/ir}
+DEPTH=${DEPTH:-2}
+PHIS=${PHIS:-2}
+DENSITY=${DENSITY:-50}
+FLAGS=${FLAGS:-}
+CSV=$BENCH_IR/scaling.csv
+
+mkdir -p "$BENCH_IR"
+
+. "$BENCH_DIR/bench-lib.sh"
+
+build_measure || exit 1
+
+echo "blocks,instructions,pass,wall_ms,peak_rss_kib" >"$CSV"
+
+printf "%-10s %12s %-12s %14s %12s\n" "blocks" "instructions" "pass" "time" "peak memory"
+for size in $SIZES; do
+    ir=$BENCH_IR/gen-$size-$DEPTH-$PHIS-$DENSITY.ll
+    o0=$BENCH_IR/gen-$size-$DEPTH-$PHIS-$DENSITY.o0.ll
+    [ -f "$ir" ] || "$BENCH_DIR/gen-cfg.sh" "$size" "$DEPTH" "$PHIS" "$DENSITY" >"$ir"
+    [ -f "$o0" ] || FORM=o0 "$BENCH_DIR/gen-cfg.sh" "$size" "$DEPTH" "$PHIS" "$DENSITY" >"$o0"
+    for pass in branch-range const-range; do
+        if [ "$pass" = branch-range ]; then
+            instructions=$(count_instructions "$ir")
+            # shellcheck disable=SC2086
+            result=$(measure_runs "$BENCH_IR/scaling.log" "$OPT" -load-pass-plugin="$BRANCH_PLUGIN" -load "$BRANCH_PLUGIN" \
+                -passes='require<branch-range>' $FLAGS "$ir" -disable-output)
+        else
+            instructions=$(count_instructions "$o0")
+            result=$(measure_runs "$BENCH_IR/scaling.log" "$OPT" -load-pass-plugin="$CONST_PLUGIN" -passes='print<const-range>' "$o0" -disable-output)
+        fi
+
+        printf "%-10s %12s %-12s" "$size" "$instructions" "$pass"
+        if [ -z "$result" ]; then
+            printf " %14s\n" "failed"
+            continue
+        fi
+        set -- $result
+        awk -v size="$size" -v instructions="$instructions" -v pass="$pass" -v ns="$1" -v kib="$2" -v csv="$CSV" 'BEGIN {
+            printf " %12.3fms %9dKiB\n", ns / 1000000, kib
+            printf "%d,%d,%s,%.3f,%d\n", size, instructions, pass, ns / 1000000, kib >>csv
+        }'
+    done
+done
+
+# Time and memory against the number of instructions, log scales
+if command -v gnuplot >/dev/null 2>&1; then
+    gnuplot <<EOF
+set terminal png size 1200,500
+set output "$BENCH_IR/scaling.png"
+set datafile separator ","
+set key autotitle columnhead left top
+set logscale xy
+set xlabel "instructions"
+set multiplot layout 1,2
+set ylabel "time (ms)"
+plot "< grep branch-range $CSV" using 2:4 with linespoints title "branch-range", \
+     "< grep const-range $CSV" using 2:4 with linespoints title "const-range"
+set ylabel "peak memory (KiB)"
+plot "< grep branch-range $CSV" using 2:5 with linespoints title "branch-range", \
+     "< grep const-range $CSV" using 2:5 with linespoints title "const-range"
+unset multiplot
+EOF
+    echo "plot: $BENCH_IR/scaling.png"
+fi
@@ -0,0 +1,82 @@
+#!/bin/sh
+# Throughput of both passes over the benchmark sources: for each file and pass, average wall time of
+# opt, instructions analyzed per second, worklist iterations (-branch-range-counters, -const-range-counters)
+# and peak resident memory of opt, printed and appended to a CSV file to compare versions of the passes
+# branch-range runs on the SSA IR (see bench-lib.sh), const-range on the clang -O0 IR
+#
+# Usage: throughput-bench.sh <LLVMBranchRange.so> <LLVMConstantRange.so>
+#   throughput-bench.sh build/lib/LLVMBranchRange.so build/lib/LLVMConstantRange.so
+#
+# Environment:
+#   LLVM_BIN  directory containing clang and opt (default: from PATH)
+#   CC        C compiler building the measure helper (default: cc)
+#   RUNS      number of runs averaged for each file and pass (default: 5)
+#   BENCH_IR  directory where the generated IR is cached (default: benchmarks/ir)
+#   SOURCES   space separated list of .c/.ll inputs (default: every benchmark source)
+#   CSV       CSV file receiving the results, created with its header (default: $BENCH_IR/throughput.csv)
+#   LABEL     version of the passes written in the label column (default: git commit of the sources)
+
+if [ $# -lt 2 ]; then
+    sed -n '2,17p' "$0"
+    exit 1
+fi
+
+BRANCH_PLUGIN=$1
+CONST_PLUGIN=$2
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+CLANG=${LLVM_BIN:+$LLVM_BIN/}clang
+OPT=${LLVM_BIN:+$LLVM_BIN/}opt
+CC=${CC:-cc}
+RUNS=${RUNS:-5}
+BENCH_IR=${BENCH_IR:-$BENCH_DIR/ir}
+SOURCES=${SOURCES:-$(ls "$BENCH_DIR"/*.c "$BENCH_DIR"/bitwise/*/*.c)}
+CSV=${CSV:-$BENCH_IR/throughput.csv}
+LABEL=${LABEL:-$(git -C "$BENCH_DIR" describe --always --dirty 2>/dev/null || echo unknown)}
+
+mkdir -p "$BENCH_IR"
+
+. "$BENCH_DIR/bench-lib.sh"
+
+build_measure || exit 1
+
+# RUNS runs of opt -passes=<passes> <flags> on ir, the output of the last one in $BENCH_IR/throughput.log
+measure_pass()
+{
+    plugin=$1
+    passes=$2
+    shift 2
+    measure_runs "$BENCH_IR/throughput.log" "$OPT" -load-pass-plugin="$plugin" -load "$plugin" -passes="$passes" "$@" "$ir" -disable-output
+}
+
+[ -f "$CSV" ] || echo "label,file,pass,instructions,runs,wall_ms,instructions_per_s,worklist_iterations,peak_rss_kib" >"$CSV"
+
+printf "%-24s %-12s %12s %14s %14s %12s %12s\n" "file" "pass" "instructions" "time" "instr/s" "iterations" "peak memory"
+for src in $SOURCES; do
+    for pass in branch-range const-range; do
+        if [ "$pass" = branch-range ]; then
+            ir=$(to_ir "$src") || exit 1
+            result=$(measure_pass "$BRANCH_PLUGIN" 'print<branch-range>' -branch-range-counters)
+        else
+            ir=$(to_o0_ir "$src") || exit 1
+            result=$(measure_pass "$CONST_PLUGIN" 'print<const-range>' -const-range-counters)
+        fi
+
+        printf "%-24s %-12s" "$(basename "$src")" "$pass"
+        if [ -z "$result" ]; then
+            printf " %12s\n" "failed"
+            continue
+        fi
+
+        instructions=$(count_instructions "$ir")
+        iterations=$(awk '/^Worklist iterations: / { sum += $3 } END { print sum + 0 }' "$BENCH_IR/throughput.log")
+        set -- $result
+        awk -v label="$LABEL" -v file="$(basename "$src")" -v pass="$pass" -v instructions="$instructions" -v runs="$RUNS" \
+            -v ns="$1" -v iterations="$iterations" -v kib="$2" -v csv="$CSV" 'BEGIN {
+            ms = ns / 1000000
+            rate = ns > 0 ? instructions / (ns / 1000000000) : 0
+            printf " %12d %12.3fms %14.0f %12d %9dKiB\n", instructions, ms, rate, iterations, kib
+            printf "%s,%s,%s,%d,%d,%.3f,%.0f,%d,%d\n", label, file, pass, instructions, runs, ms, rate, iterations, kib >>csv
+        }'
+    done
+done
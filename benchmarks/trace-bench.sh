@@ -0,0 +1,29 @@
+#!/bin/sh
+# Wall time of the branch-range pass with the trace on and off (hash.c and adpcm.c)
+#
+# Usage: trace-bench.sh <LLVMBranchRange.so> [<LLVMBranchRange.so built with -DNDEBUG>]
+#   on:       -debug-only=branch-range, every transfer function (needs opt built with assertions)
+#   updates:  -debug-only=branch-range -branch-range-trace-level=1
+#   off:      no -debug-only, trace statements compiled in but disabled
+#   The second plugin (optional) is timed without trace, trace statements compiled out
+#
+# Environment: same as run-bench.sh (LLVM_BIN, RUNS, BENCH_IR, OPT_FLAGS, TRACE_LOG)
+
+if [ $# -lt 1 ]; then
+    sed -n '2,11p' "$0"
+    exit 1
+fi
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+SOURCES=${SOURCES:-"$BENCH_DIR/hash.c $BENCH_DIR/bitwise/Bitwise/adpcm.c"}
+export SOURCES
+
+"$BENCH_DIR/run-bench.sh" "$1" \
+    on=-debug-only=branch-range \
+    updates="-debug-only=branch-range -branch-range-trace-level=1" \
+    off=
+
+if [ $# -ge 2 ]; then
+    echo
+    "$BENCH_DIR/run-bench.sh" "$2" release=
+fi